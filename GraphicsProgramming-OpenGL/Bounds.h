@@ -0,0 +1,17 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Axis aligned bounds of a transformed axis aligned box (Arvo's method)
+inline auto TransformBounds(const glm::mat4 & matrix, const glm::vec3 & min, const glm::vec3 & max, glm::vec3 & outMin, glm::vec3 & outMax) -> void
+{
+	outMin = glm::vec3(matrix[3]);
+	outMax = glm::vec3(matrix[3]);
+
+	for (auto column = 0; column < 3; ++column) for (auto row = 0; row < 3; ++row)
+	{
+		const auto a = matrix[column][row] * min[column];
+		const auto b = matrix[column][row] * max[column];
+		outMin[row] += glm::min(a, b);
+		outMax[row] += glm::max(a, b);
+	}
+}
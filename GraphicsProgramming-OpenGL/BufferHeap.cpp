@@ -0,0 +1,368 @@
+#include "BufferHeap.h"
+#include <glad/glad.h>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	auto HighestBit(const unsigned int value) -> unsigned int
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, value);
+		return index;
+#else
+		return 31 - __builtin_clz(value);
+#endif
+	}
+
+	auto LowestBit(const unsigned int value) -> unsigned int
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return index;
+#else
+		return __builtin_ctz(value);
+#endif
+	}
+
+	// First and second level list of a size. Sizes below BUFFER_HEAP_SL_COUNT get a list
+	// each, larger ones share a list with sizes in the same 1/16th of their power of two.
+	auto Mapping(const unsigned int count, unsigned int & firstLevel, unsigned int & secondLevel) -> void
+	{
+		if (count < BUFFER_HEAP_SL_COUNT)
+		{
+			firstLevel = 0;
+			secondLevel = count;
+			return;
+		}
+
+		const auto highest = HighestBit(count);
+		firstLevel = highest - BUFFER_HEAP_SL_LOG2 + 1;
+		secondLevel = (count >> (highest - BUFFER_HEAP_SL_LOG2)) ^ BUFFER_HEAP_SL_COUNT;
+	}
+}
+
+BufferHeap::BufferHeap(const unsigned int stride, const unsigned int capacity) :
+	buffers_(1, 0), strides_(1, stride)
+{
+	for (auto& lists : freeLists_)
+	{
+		std::fill(std::begin(lists), std::end(lists), BUFFER_HEAP_INVALID);
+	}
+
+	Grow(capacity);
+}
+
+auto BufferHeap::Allocate(const unsigned int count) -> unsigned int
+{
+	if (count == 0) return BUFFER_HEAP_INVALID;
+
+	const auto block = FindFree(count);
+	if (block == BUFFER_HEAP_INVALID) return BUFFER_HEAP_INVALID;
+	RemoveFree(block);
+
+	// Return the tail as a new free block ----------------------------------------------------------
+	if (blocks_[block].count > count)
+	{
+		const auto remainder = NewBlock(blocks_[block].offset + count, blocks_[block].count - count, block, blocks_[block].next);
+		if (blocks_[remainder].next != BUFFER_HEAP_INVALID) blocks_[blocks_[remainder].next].previous = remainder;
+		else lastBlock_ = remainder;
+
+		blocks_[block].next = remainder;
+		blocks_[block].count = count;
+		InsertFree(remainder);
+	}
+
+	blocks_[block].free = false;
+	used_ += count;
+	++allocations_;
+	return block;
+}
+
+auto BufferHeap::Free(const unsigned int allocation) -> void
+{
+	if (allocation == BUFFER_HEAP_INVALID || blocks_[allocation].free) return;
+
+	blocks_[allocation].free = true;
+	used_ -= blocks_[allocation].count;
+	--allocations_;
+
+	InsertFree(Merge(allocation));
+}
+
+auto BufferHeap::Offset(const unsigned int allocation) const -> unsigned int
+{
+	return allocation != BUFFER_HEAP_INVALID ? blocks_[allocation].offset : 0;
+}
+
+auto BufferHeap::Count(const unsigned int allocation) const -> unsigned int
+{
+	return allocation != BUFFER_HEAP_INVALID ? blocks_[allocation].count : 0;
+}
+
+auto BufferHeap::AddStream(const unsigned int stride) -> unsigned int
+{
+	buffers_.push_back(CreateBuffer(capacity_, stride));
+	strides_.push_back(stride);
+	return static_cast<unsigned int>(buffers_.size() - 1);
+}
+
+auto BufferHeap::Upload(const unsigned int allocation, const void* data, const unsigned int count, const unsigned int stream) -> void
+{
+	if (allocation == BUFFER_HEAP_INVALID || count == 0 || stream >= buffers_.size()) return;
+
+	const auto stride = strides_[stream];
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffers_[stream]);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(blocks_[allocation].offset) * stride,
+		static_cast<GLsizeiptr>(std::min(count, blocks_[allocation].count)) * stride, data);
+}
+
+auto BufferHeap::Grow(const unsigned int capacity) -> void
+{
+	if (capacity <= capacity_) return;
+
+	// Copy the old contents over ------------------------------------------------------------------
+	for (unsigned int stream = 0; stream < buffers_.size(); ++stream)
+	{
+		const auto buffer = CreateBuffer(capacity, strides_[stream]);
+		if (buffers_[stream] != 0)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, buffers_[stream]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(capacity_) * strides_[stream]);
+			glDeleteBuffers(1, &buffers_[stream]);
+		}
+		buffers_[stream] = buffer;
+	}
+
+	// Extend the free block at the end, or add one ------------------------------------------------
+	const auto extra = capacity - capacity_;
+	if (lastBlock_ != BUFFER_HEAP_INVALID && blocks_[lastBlock_].free)
+	{
+		RemoveFree(lastBlock_);
+		blocks_[lastBlock_].count += extra;
+		InsertFree(lastBlock_);
+	}
+	else
+	{
+		const auto block = NewBlock(capacity_, extra, lastBlock_, BUFFER_HEAP_INVALID);
+		if (lastBlock_ != BUFFER_HEAP_INVALID) blocks_[lastBlock_].next = block;
+		lastBlock_ = block;
+		InsertFree(block);
+	}
+
+	capacity_ = capacity;
+}
+
+auto BufferHeap::Defragment() -> void
+{
+	// Live allocations in address order -----------------------------------------------------------
+	auto allocations = std::vector<unsigned int>();
+	for (unsigned int block = 0; block < blocks_.size(); ++block)
+	{
+		if (!blocks_[block].live) continue;
+
+		if (blocks_[block].free) ReleaseBlock(block);
+		else allocations.push_back(block);
+	}
+	std::sort(allocations.begin(), allocations.end(), [this](const unsigned int a, const unsigned int b)
+	{
+		return blocks_[a].offset < blocks_[b].offset;
+	});
+
+	firstLevelMap_ = 0;
+	std::fill(std::begin(secondLevelMap_), std::end(secondLevelMap_), 0u);
+	for (auto& lists : freeLists_)
+	{
+		std::fill(std::begin(lists), std::end(lists), BUFFER_HEAP_INVALID);
+	}
+
+	// Copy them to the front of new buffers, the handles stay the same --------------------------
+	for (unsigned int stream = 0; stream < buffers_.size(); ++stream)
+	{
+		const auto stride = strides_[stream];
+		const auto buffer = CreateBuffer(capacity_, stride);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffers_[stream]);
+
+		auto offset = 0u;
+		for (auto block : allocations)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(blocks_[block].offset) * stride,
+				static_cast<GLintptr>(offset) * stride, static_cast<GLsizeiptr>(blocks_[block].count) * stride);
+			offset += blocks_[block].count;
+		}
+
+		glDeleteBuffers(1, &buffers_[stream]);
+		buffers_[stream] = buffer;
+	}
+
+	auto offset = 0u;
+	auto previous = BUFFER_HEAP_INVALID;
+	for (auto block : allocations)
+	{
+		blocks_[block].offset = offset;
+		blocks_[block].previous = previous;
+		blocks_[block].next = BUFFER_HEAP_INVALID;
+		if (previous != BUFFER_HEAP_INVALID) blocks_[previous].next = block;
+
+		offset += blocks_[block].count;
+		previous = block;
+	}
+
+	lastBlock_ = previous;
+
+	if (offset < capacity_)
+	{
+		const auto block = NewBlock(offset, capacity_ - offset, previous, BUFFER_HEAP_INVALID);
+		if (previous != BUFFER_HEAP_INVALID) blocks_[previous].next = block;
+		lastBlock_ = block;
+		InsertFree(block);
+	}
+}
+
+auto BufferHeap::Buffer(const unsigned int stream) const -> unsigned int
+{
+	return stream < buffers_.size() ? buffers_[stream] : 0;
+}
+
+auto BufferHeap::Stride(const unsigned int stream) const -> unsigned int
+{
+	return stream < strides_.size() ? strides_[stream] : 0;
+}
+
+auto BufferHeap::Stats() const -> BufferHeapStats
+{
+	auto stats = BufferHeapStats{ capacity_, used_, allocations_, 0, 0 };
+	for (auto& block : blocks_)
+	{
+		if (!block.live || !block.free) continue;
+
+		++stats.freeBlocks;
+		stats.largestFree = std::max(stats.largestFree, block.count);
+	}
+	return stats;
+}
+
+auto BufferHeap::NewBlock(const unsigned int offset, const unsigned int count, const unsigned int previous, const unsigned int next) -> unsigned int
+{
+	const auto block = Block{ offset, count, true, true, previous, next, BUFFER_HEAP_INVALID, BUFFER_HEAP_INVALID };
+	if (!unusedBlocks_.empty())
+	{
+		const auto index = unusedBlocks_.back();
+		unusedBlocks_.pop_back();
+		blocks_[index] = block;
+		return index;
+	}
+
+	blocks_.push_back(block);
+	return static_cast<unsigned int>(blocks_.size() - 1);
+}
+
+auto BufferHeap::ReleaseBlock(const unsigned int block) -> void
+{
+	blocks_[block].live = false;
+	unusedBlocks_.push_back(block);
+}
+
+auto BufferHeap::InsertFree(const unsigned int block) -> void
+{
+	unsigned int firstLevel, secondLevel;
+	Mapping(blocks_[block].count, firstLevel, secondLevel);
+
+	auto& head = freeLists_[firstLevel][secondLevel];
+	blocks_[block].previousFree = BUFFER_HEAP_INVALID;
+	blocks_[block].nextFree = head;
+	if (head != BUFFER_HEAP_INVALID) blocks_[head].previousFree = block;
+	head = block;
+
+	firstLevelMap_ |= 1u << firstLevel;
+	secondLevelMap_[firstLevel] |= 1u << secondLevel;
+}
+
+auto BufferHeap::RemoveFree(const unsigned int block) -> void
+{
+	unsigned int firstLevel, secondLevel;
+	Mapping(blocks_[block].count, firstLevel, secondLevel);
+
+	const auto previous = blocks_[block].previousFree;
+	const auto next = blocks_[block].nextFree;
+	if (previous != BUFFER_HEAP_INVALID) blocks_[previous].nextFree = next;
+	if (next != BUFFER_HEAP_INVALID) blocks_[next].previousFree = previous;
+
+	auto& head = freeLists_[firstLevel][secondLevel];
+	if (head != block) return;
+
+	head = next;
+	if (head == BUFFER_HEAP_INVALID)
+	{
+		secondLevelMap_[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelMap_[firstLevel] == 0) firstLevelMap_ &= ~(1u << firstLevel);
+	}
+}
+
+// Head of the first non-empty list whose blocks are all at least count large
+auto BufferHeap::FindFree(unsigned int count) const -> unsigned int
+{
+	// Round up to the next list boundary, so any block of the list found fits
+	if (count >= BUFFER_HEAP_SL_COUNT)
+	{
+		count += (1u << (HighestBit(count) - BUFFER_HEAP_SL_LOG2)) - 1;
+	}
+
+	unsigned int firstLevel, secondLevel;
+	Mapping(count, firstLevel, secondLevel);
+
+	auto secondLevelMap = secondLevelMap_[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		const auto firstLevelMap = firstLevel + 1 < BUFFER_HEAP_FL_COUNT ? firstLevelMap_ & (~0u << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0) return BUFFER_HEAP_INVALID;
+
+		firstLevel = LowestBit(firstLevelMap);
+		secondLevelMap = secondLevelMap_[firstLevel];
+	}
+
+	return freeLists_[firstLevel][LowestBit(secondLevelMap)];
+}
+
+// Fold free address order neighbours into a free block, returns the surviving block
+auto BufferHeap::Merge(unsigned int block) -> unsigned int
+{
+	const auto next = blocks_[block].next;
+	if (next != BUFFER_HEAP_INVALID && blocks_[next].free)
+	{
+		RemoveFree(next);
+		blocks_[block].count += blocks_[next].count;
+		blocks_[block].next = blocks_[next].next;
+		if (blocks_[block].next != BUFFER_HEAP_INVALID) blocks_[blocks_[block].next].previous = block;
+		else lastBlock_ = block;
+		ReleaseBlock(next);
+	}
+
+	const auto previous = blocks_[block].previous;
+	if (previous != BUFFER_HEAP_INVALID && blocks_[previous].free)
+	{
+		RemoveFree(previous);
+		blocks_[previous].count += blocks_[block].count;
+		blocks_[previous].next = blocks_[block].next;
+		if (blocks_[previous].next != BUFFER_HEAP_INVALID) blocks_[blocks_[previous].next].previous = previous;
+		else lastBlock_ = previous;
+		ReleaseBlock(block);
+		block = previous;
+	}
+
+	return block;
+}
+
+// Leaves the new buffer bound to GL_COPY_WRITE_BUFFER
+auto BufferHeap::CreateBuffer(const unsigned int capacity, const unsigned int stride) -> unsigned int
+{
+	unsigned int buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity) * stride, nullptr, GL_STATIC_DRAW);
+	return buffer;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+
+// Allocation handle, stays valid across Grow and Defragment
+const unsigned int BUFFER_HEAP_INVALID = ~0u;
+
+// Second level subdivisions per power of two (2^4)
+const unsigned int BUFFER_HEAP_SL_LOG2 = 4;
+const unsigned int BUFFER_HEAP_SL_COUNT = 1 << BUFFER_HEAP_SL_LOG2;
+const unsigned int BUFFER_HEAP_FL_COUNT = 32;
+
+struct BufferHeapStats
+{
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int allocations;
+	unsigned int freeBlocks;
+	unsigned int largestFree;
+};
+
+// One GL buffer handed out in ranges of fixed size elements (vertices, indices), so
+// offsets can be used directly as baseVertex / firstIndex. Free ranges are kept in
+// two level segregated fit lists (TLSF), allocation and free are O(1) and neighbouring
+// free ranges are merged right away. The buffer is only bound to the copy targets, so
+// it can be filled while any VAO is bound.
+// Extra streams are parallel buffers with their own stride, e.g. a second attribute
+// layout of the same vertices. They share every allocation and offset with stream 0.
+class BufferHeap
+{
+public:
+	BufferHeap(unsigned int stride, unsigned int capacity);
+
+	// BUFFER_HEAP_INVALID when no free range is large enough, see Grow
+	auto Allocate(unsigned int count) -> unsigned int;
+	auto Free(unsigned int allocation) -> void;
+
+	// Element offset and count of an allocation
+	auto Offset(unsigned int allocation) const -> unsigned int;
+	auto Count(unsigned int allocation) const -> unsigned int;
+
+	// Add a buffer of capacity elements of another stride, returns its stream index
+	auto AddStream(unsigned int stride) -> unsigned int;
+
+	// Copy elements into an allocation, starting at its first element
+	auto Upload(unsigned int allocation, const void * data, unsigned int count, unsigned int stream = 0) -> void;
+
+	// Move to larger buffers, keeping every allocation at its offset. Replaces the GL
+	// buffers, so VAOs that reference them must be set up again.
+	auto Grow(unsigned int capacity) -> void;
+
+	// Pack every allocation towards the start of new buffers, leaving one free range at
+	// the end. Offsets change and the GL buffers are replaced.
+	auto Defragment() -> void;
+
+	auto Buffer(unsigned int stream = 0) const -> unsigned int;
+	auto Stride(unsigned int stream = 0) const -> unsigned int;
+	auto Stats() const -> BufferHeapStats;
+
+private:
+	struct Block
+	{
+		unsigned int offset;
+		unsigned int count;
+		bool free;
+		bool live;
+
+		// Address order neighbours and free list links, block indices or BUFFER_HEAP_INVALID
+		unsigned int previous;
+		unsigned int next;
+		unsigned int previousFree;
+		unsigned int nextFree;
+	};
+
+	// Per stream
+	std::vector<unsigned int> buffers_;
+	std::vector<unsigned int> strides_;
+	unsigned int capacity_ = 0;
+	unsigned int used_ = 0;
+	unsigned int allocations_ = 0;
+
+	std::vector<Block> blocks_;
+	std::vector<unsigned int> unusedBlocks_;
+	unsigned int lastBlock_ = BUFFER_HEAP_INVALID;
+
+	// Bit per non-empty first level, and per non-empty list within each first level
+	unsigned int firstLevelMap_ = 0;
+	unsigned int secondLevelMap_[BUFFER_HEAP_FL_COUNT] = {};
+	unsigned int freeLists_[BUFFER_HEAP_FL_COUNT][BUFFER_HEAP_SL_COUNT];
+
+	auto NewBlock(unsigned int offset, unsigned int count, unsigned int previous, unsigned int next) -> unsigned int;
+	auto ReleaseBlock(unsigned int block) -> void;
+	auto InsertFree(unsigned int block) -> void;
+	auto RemoveFree(unsigned int block) -> void;
+	auto FindFree(unsigned int count) const -> unsigned int;
+	auto Merge(unsigned int block) -> unsigned int;
+	auto CreateBuffer(unsigned int capacity, unsigned int stride) -> unsigned int;
+};
@@ -89,6 +89,20 @@ glm::vec3 Camera::GetUp()
 	return glm::vec3(Up);
 }
 
+auto Camera::ProjectedSize(const glm::vec3& center, const float radius, const float fov, const float screenHeight) const -> float
+{
+	const auto distanceSquared = glm::dot(center - Position, center - Position);
+
+	// Inside the sphere it covers the whole screen
+	if (distanceSquared <= radius * radius)
+	{
+		return screenHeight;
+	}
+
+	const auto projectedRadius = radius / (glm::sqrt(distanceSquared - radius * radius) * glm::tan(glm::radians(fov) * 0.5f));
+	return projectedRadius * screenHeight;
+}
+
 auto Camera::UpdateCameraState() -> void
 {
 	glm::vec3 front;
@@ -46,6 +46,9 @@ public:
 	glm::vec3 GetFront();
 	glm::vec3 GetUp();
 
+	// Projected diameter in pixels of a bounding sphere for a vertical field of view (degrees)
+	auto ProjectedSize(const glm::vec3 & center, float radius, float fov, float screenHeight) const -> float;
+
 private:
 	auto UpdateCameraState() -> void;
 
@@ -0,0 +1,153 @@
+#include "FrameBenchmark.h"
+#include <glad/glad.h>
+#include <iomanip>
+
+FrameBenchmark::FrameBenchmark()
+{
+	for (auto& pending : queries_)
+	{
+		glGenQueries(1, &pending.query);
+		pending.issued = false;
+		pending.benchmarkCase = ~0u;
+		pending.cpuMilliseconds = 0.0;
+	}
+}
+
+FrameBenchmark::~FrameBenchmark()
+{
+	for (auto& pending : queries_)
+	{
+		glDeleteQueries(1, &pending.query);
+	}
+}
+
+auto FrameBenchmark::Start(const std::vector<std::string>& cases, const unsigned int framesPerCase) -> void
+{
+	if (cases.empty() || framesPerCase == 0) return;
+
+	results_.clear();
+	for (auto& name : cases)
+	{
+		results_.push_back(BenchmarkResult{ name, 0, 0.0, 0.0 });
+	}
+
+	framesPerCase_ = framesPerCase;
+	currentCase_ = 0;
+	caseFrame_ = 0;
+	running_ = true;
+	draining_ = false;
+}
+
+auto FrameBenchmark::Running() const -> bool
+{
+	return running_;
+}
+
+auto FrameBenchmark::CurrentCase() const -> unsigned int
+{
+	return currentCase_;
+}
+
+auto FrameBenchmark::BeginFrame() -> void
+{
+	// The oldest query is reused, its result is read first
+	auto& pending = queries_[nextQuery_];
+	if (pending.issued) Collect(pending);
+
+	frameStart_ = std::chrono::high_resolution_clock::now();
+	glBeginQuery(GL_TIME_ELAPSED, pending.query);
+}
+
+auto FrameBenchmark::EndFrame() -> void
+{
+	glEndQuery(GL_TIME_ELAPSED);
+
+	auto& pending = queries_[nextQuery_];
+	pending.issued = true;
+	pending.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart_).count();
+	pending.benchmarkCase = ~0u;
+	nextQuery_ = (nextQuery_ + 1) % BENCHMARK_QUERY_COUNT;
+
+	if (!running_) return;
+
+	if (!draining_)
+	{
+		// Frames right after a switch still pay for it
+		if (caseFrame_ >= BENCHMARK_WARMUP_FRAMES) pending.benchmarkCase = currentCase_;
+
+		if (++caseFrame_ == BENCHMARK_WARMUP_FRAMES + framesPerCase_)
+		{
+			caseFrame_ = 0;
+			if (++currentCase_ == results_.size())
+			{
+				currentCase_ = static_cast<unsigned int>(results_.size()) - 1;
+				draining_ = true;
+			}
+		}
+		return;
+	}
+
+	// Every measured frame is in once none of the queries in flight belongs to a case
+	for (auto& query : queries_)
+	{
+		if (query.issued && query.benchmarkCase != ~0u) return;
+	}
+	Finish();
+}
+
+auto FrameBenchmark::Collect(PendingQuery& pending) -> void
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+	pending.issued = false;
+
+	gpuMilliseconds_ = static_cast<double>(elapsed) / 1.0e6;
+	cpuMilliseconds_ = pending.cpuMilliseconds;
+
+	if (running_ && pending.benchmarkCase < results_.size())
+	{
+		auto& result = results_[pending.benchmarkCase];
+		++result.frames;
+		result.gpuMilliseconds += gpuMilliseconds_;
+		result.cpuMilliseconds += cpuMilliseconds_;
+	}
+	pending.benchmarkCase = ~0u;
+}
+
+auto FrameBenchmark::Finish() -> void
+{
+	for (auto& result : results_)
+	{
+		if (result.frames == 0) continue;
+		result.gpuMilliseconds /= result.frames;
+		result.cpuMilliseconds /= result.frames;
+	}
+
+	running_ = false;
+	draining_ = false;
+}
+
+auto FrameBenchmark::GpuMilliseconds() const -> double
+{
+	return gpuMilliseconds_;
+}
+
+auto FrameBenchmark::CpuMilliseconds() const -> double
+{
+	return cpuMilliseconds_;
+}
+
+auto FrameBenchmark::Results() const -> const std::vector<BenchmarkResult>&
+{
+	return results_;
+}
+
+auto FrameBenchmark::Report(std::ostream& stream) const -> void
+{
+	stream << "Frame benchmark, average of " << framesPerCase_ << " frames per case" << std::endl;
+	for (auto& result : results_)
+	{
+		stream << "  " << std::left << std::setw(24) << result.name << std::fixed << std::setprecision(3)
+			<< " gpu " << result.gpuMilliseconds << " ms, cpu " << result.cpuMilliseconds << " ms" << std::endl;
+	}
+}
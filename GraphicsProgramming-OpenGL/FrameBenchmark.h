@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timer queries in flight, results are read this many frames late so they are ready
+const unsigned int BENCHMARK_QUERY_COUNT = 4;
+// Frames measured per case, after the warm-up frames that follow a switch
+const unsigned int BENCHMARK_FRAMES = 300;
+const unsigned int BENCHMARK_WARMUP_FRAMES = 10;
+
+struct BenchmarkResult
+{
+	std::string name;
+	unsigned int frames;
+	double gpuMilliseconds;
+	double cpuMilliseconds;
+};
+
+// GPU and CPU time of every frame, GPU time from GL_TIME_ELAPSED queries. Start runs a
+// benchmark that renders each case (a rendering mode chosen by the caller through
+// CurrentCase) for a fixed number of frames and reports the averages once all results
+// are in.
+class FrameBenchmark
+{
+public:
+	FrameBenchmark();
+	~FrameBenchmark();
+	FrameBenchmark(const FrameBenchmark &) = delete;
+	auto operator=(const FrameBenchmark &) -> FrameBenchmark & = delete;
+
+	auto Start(const std::vector<std::string> & cases, unsigned int framesPerCase = BENCHMARK_FRAMES) -> void;
+	auto Running() const -> bool;
+	// Case to render this frame while running
+	auto CurrentCase() const -> unsigned int;
+
+	// Bracket everything a frame submits, not the buffer swap
+	auto BeginFrame() -> void;
+	auto EndFrame() -> void;
+
+	// Latest completed frame, in milliseconds
+	auto GpuMilliseconds() const -> double;
+	auto CpuMilliseconds() const -> double;
+
+	// Filled when a benchmark finishes
+	auto Results() const -> const std::vector<BenchmarkResult> &;
+	auto Report(std::ostream & stream) const -> void;
+
+private:
+	struct PendingQuery
+	{
+		unsigned int query;
+		bool issued;
+		// Case the frame belongs to, or ~0u when it isn't measured
+		unsigned int benchmarkCase;
+		double cpuMilliseconds;
+	};
+
+	PendingQuery queries_[BENCHMARK_QUERY_COUNT];
+	unsigned int nextQuery_ = 0;
+	std::chrono::high_resolution_clock::time_point frameStart_;
+
+	double gpuMilliseconds_ = 0.0;
+	double cpuMilliseconds_ = 0.0;
+
+	std::vector<BenchmarkResult> results_;
+	unsigned int framesPerCase_ = 0;
+	unsigned int currentCase_ = 0;
+	unsigned int caseFrame_ = 0;
+	bool running_ = false;
+	// All frames issued, waiting for the last results
+	bool draining_ = false;
+
+	auto Collect(PendingQuery & pending) -> void;
+	auto Finish() -> void;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "Camera.h"
+
+// Everything the render thread needs from one simulation step. Filled by the simulation,
+// read only once it is handed over through a TripleBuffer.
+struct FrameSnapshot
+{
+	// Simulation steps so far, 0 before the first one
+	unsigned long long step = 0;
+	double time = 0.0;
+
+	Camera camera;
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	bool shadowMap = false;
+	bool depthPrepass = false;
+	// Benchmark runs requested so far
+	unsigned int benchmarkRequests = 0;
+
+	glm::vec3 lightPos = glm::vec3(0);
+
+	// Animated objects
+	float emissionIntensity = 0.0f;
+	std::vector<glm::mat4> cubeTransforms;
+};
@@ -7,7 +7,7 @@
 #include "FrustumG.h"
 #include <math.h>
 #include "Vec3.h"
-#include <glm/detail/func_geometric.inl>
+#include <glm/geometric.hpp>
 
 #define ANG2RAD 3.14159265358979323846/180.0
 
@@ -39,10 +39,10 @@ void FrustumG::setCamDef(glm::vec3 p, glm::vec3 l, glm::vec3 u) {
 	Z = p - l;
 	Z = glm::normalize(Z);
 
-	X = u * Z;
+	X = glm::cross(u, Z);
 	X = glm::normalize(X);
 
-	Y = Z * X;
+	Y = glm::cross(Z, X);
 
 	nc = p - Z * nearD;
 	fc = p - Z * farD;
@@ -66,6 +66,28 @@ void FrustumG::setCamDef(glm::vec3 p, glm::vec3 l, glm::vec3 u) {
 }
 
 
+// Extract the planes from a view-projection matrix (Gribb & Hartmann).
+// Works for orthographic projections too, e.g. a light's shadow frustum.
+void FrustumG::setFromMatrix(const glm::mat4 &m) {
+
+	// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	const auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+	const auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+	const glm::vec4 coefficients[6] = {
+		r3 - r1,	// TOP
+		r3 + r1,	// BOTTOM
+		r3 + r0,	// LEFT
+		r3 - r0,	// RIGHT
+		r3 + r2,	// NEARP
+		r3 - r2		// FARP
+	};
+
+	for (auto i = 0; i < 6; ++i)
+		pl[i].setCoefficients(coefficients[i].x, coefficients[i].y, coefficients[i].z, coefficients[i].w);
+}
+
+
 int FrustumG::pointInFrustum(glm::vec3 &p) {
 	for (auto& plane : pl)
 	{
@@ -75,3 +97,111 @@ int FrustumG::pointInFrustum(glm::vec3 &p) {
 	return(INSIDE);
 
 }
+
+
+int FrustumG::sphereInFrustum(glm::vec3 &p, float radius) {
+
+	auto result = INSIDE;
+	for (auto& plane : pl)
+	{
+		const auto distance = plane.distance(p);
+		if (distance < -radius)
+			return OUTSIDE;
+		if (distance < radius)
+			result = INTERSECT;
+	}
+	return(result);
+}
+
+
+// Axis aligned box test using the positive/negative vertex of each plane
+int FrustumG::boxInFrustum(glm::vec3 &min, glm::vec3 &max) {
+
+	auto result = INSIDE;
+	for (auto& plane : pl)
+	{
+		auto p = glm::vec3(plane.normal.x > 0 ? max.x : min.x,
+		                   plane.normal.y > 0 ? max.y : min.y,
+		                   plane.normal.z > 0 ? max.z : min.z);
+		if (plane.distance(p) < 0)
+			return OUTSIDE;
+
+		auto n = glm::vec3(plane.normal.x > 0 ? min.x : max.x,
+		                   plane.normal.y > 0 ? min.y : max.y,
+		                   plane.normal.z > 0 ? min.z : max.z);
+		if (plane.distance(n) < 0)
+			result = INTERSECT;
+	}
+	return(result);
+}
+
+
+// Plane coherent box test: the plane that rejected the box last time is tried first,
+// and lastPlane is updated to whichever plane rejects it this time
+int FrustumG::boxInFrustum(glm::vec3 &min, glm::vec3 &max, int &lastPlane) {
+
+	if (lastPlane >= 0 && lastPlane < 6)
+	{
+		auto& plane = pl[lastPlane];
+		auto p = glm::vec3(plane.normal.x > 0 ? max.x : min.x,
+		                   plane.normal.y > 0 ? max.y : min.y,
+		                   plane.normal.z > 0 ? max.z : min.z);
+		if (plane.distance(p) < 0)
+			return OUTSIDE;
+	}
+
+	auto result = INSIDE;
+	for (auto i = 0; i < 6; ++i)
+	{
+		if (i == lastPlane) continue;
+
+		auto& plane = pl[i];
+		auto p = glm::vec3(plane.normal.x > 0 ? max.x : min.x,
+		                   plane.normal.y > 0 ? max.y : min.y,
+		                   plane.normal.z > 0 ? max.z : min.z);
+		if (plane.distance(p) < 0)
+		{
+			lastPlane = i;
+			return OUTSIDE;
+		}
+
+		auto n = glm::vec3(plane.normal.x > 0 ? min.x : max.x,
+		                   plane.normal.y > 0 ? min.y : max.y,
+		                   plane.normal.z > 0 ? min.z : max.z);
+		if (plane.distance(n) < 0)
+			result = INTERSECT;
+	}
+
+	// The last plane was passed, but the box may still straddle it
+	if (lastPlane >= 0 && lastPlane < 6 && result == INSIDE)
+	{
+		auto& plane = pl[lastPlane];
+		auto n = glm::vec3(plane.normal.x > 0 ? min.x : max.x,
+		                   plane.normal.y > 0 ? min.y : max.y,
+		                   plane.normal.z > 0 ? min.z : max.z);
+		if (plane.distance(n) < 0)
+			result = INTERSECT;
+	}
+
+	lastPlane = -1;
+	return(result);
+}
+
+
+// Test the volume a box sweeps out when moved along 'sweep' (e.g. a shadow
+// caster extruded along the light direction). The swept volume is the convex
+// hull of the box at both ends, so it only lies outside a plane when the
+// positive vertex is outside at both ends of the sweep.
+int FrustumG::sweptBoxInFrustum(glm::vec3 &min, glm::vec3 &max, glm::vec3 &sweep) {
+
+	for (auto& plane : pl)
+	{
+		auto p = glm::vec3(plane.normal.x > 0 ? max.x : min.x,
+		                   plane.normal.y > 0 ? max.y : min.y,
+		                   plane.normal.z > 0 ? max.z : min.z);
+		auto pSwept = p + sweep;
+		if (plane.distance(p) < 0 && plane.distance(pSwept) < 0)
+			return OUTSIDE;
+	}
+	return(INTERSECT);
+}
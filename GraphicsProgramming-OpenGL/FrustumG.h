@@ -18,6 +18,8 @@ class Vec3;
 #include "Plane.h"
 #endif
 
+#include <glm/mat4x4.hpp>
+
 class Plane;
 
 #ifndef _AABOX_
@@ -56,7 +58,12 @@ public:
 
 	void setCamInternals(float angle, float ratio, float nearD, float farD);
 	void setCamDef(glm::vec3 p, glm::vec3 l, glm::vec3 u);
+	void setFromMatrix(const glm::mat4 &m);
 	int  pointInFrustum(glm::vec3 &p);
+	int  sphereInFrustum(glm::vec3 &p, float radius);
+	int  boxInFrustum(glm::vec3 &min, glm::vec3 &max);
+	int  boxInFrustum(glm::vec3 &min, glm::vec3 &max, int &lastPlane);
+	int  sweptBoxInFrustum(glm::vec3 &min, glm::vec3 &max, glm::vec3 &sweep);
 };
 
 
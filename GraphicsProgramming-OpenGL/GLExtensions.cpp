@@ -0,0 +1,64 @@
+#include "GLExtensions.h"
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+bool GLExtensions::multiDrawIndirect = false;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC GLExtensions::MultiDrawElementsIndirect = nullptr;
+bool GLExtensions::bindlessTextures = false;
+PFNGLGETTEXTUREHANDLEARBPROC GLExtensions::GetTextureHandleARB = nullptr;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC GLExtensions::MakeTextureHandleResidentARB = nullptr;
+bool GLExtensions::vertexAttribBinding = false;
+PFNGLBINDVERTEXBUFFERPROC GLExtensions::BindVertexBuffer = nullptr;
+PFNGLVERTEXATTRIBFORMATPROC GLExtensions::VertexAttribFormat = nullptr;
+PFNGLVERTEXATTRIBIFORMATPROC GLExtensions::VertexAttribIFormat = nullptr;
+PFNGLVERTEXATTRIBBINDINGPROC GLExtensions::VertexAttribBinding = nullptr;
+PFNGLVERTEXBINDINGDIVISORPROC GLExtensions::VertexBindingDivisor = nullptr;
+bool GLExtensions::bufferStorage = false;
+PFNGLBUFFERSTORAGEPROC GLExtensions::BufferStorage = nullptr;
+
+namespace
+{
+	auto VersionAtLeast(const int major, const int minor) -> bool
+	{
+		return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+	}
+}
+
+auto GLExtensions::Load() -> void
+{
+	if (VersionAtLeast(4, 3) || glfwExtensionSupported("GL_ARB_multi_draw_indirect"))
+	{
+		MultiDrawElementsIndirect = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC>(glfwGetProcAddress("glMultiDrawElementsIndirect"));
+	}
+	multiDrawIndirect = MultiDrawElementsIndirect != nullptr;
+
+	if (VersionAtLeast(4, 3) && glfwExtensionSupported("GL_ARB_bindless_texture"))
+	{
+		GetTextureHandleARB = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(glfwGetProcAddress("glGetTextureHandleARB"));
+		MakeTextureHandleResidentARB = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(glfwGetProcAddress("glMakeTextureHandleResidentARB"));
+	}
+	bindlessTextures = GetTextureHandleARB != nullptr && MakeTextureHandleResidentARB != nullptr;
+
+	if (VersionAtLeast(4, 3) || glfwExtensionSupported("GL_ARB_vertex_attrib_binding"))
+	{
+		BindVertexBuffer = reinterpret_cast<PFNGLBINDVERTEXBUFFERPROC>(glfwGetProcAddress("glBindVertexBuffer"));
+		VertexAttribFormat = reinterpret_cast<PFNGLVERTEXATTRIBFORMATPROC>(glfwGetProcAddress("glVertexAttribFormat"));
+		VertexAttribIFormat = reinterpret_cast<PFNGLVERTEXATTRIBIFORMATPROC>(glfwGetProcAddress("glVertexAttribIFormat"));
+		VertexAttribBinding = reinterpret_cast<PFNGLVERTEXATTRIBBINDINGPROC>(glfwGetProcAddress("glVertexAttribBinding"));
+		VertexBindingDivisor = reinterpret_cast<PFNGLVERTEXBINDINGDIVISORPROC>(glfwGetProcAddress("glVertexBindingDivisor"));
+	}
+	vertexAttribBinding = BindVertexBuffer != nullptr && VertexAttribFormat != nullptr && VertexAttribIFormat != nullptr
+		&& VertexAttribBinding != nullptr && VertexBindingDivisor != nullptr;
+
+	if (VersionAtLeast(4, 4) || glfwExtensionSupported("GL_ARB_buffer_storage"))
+	{
+		BufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+	}
+	bufferStorage = BufferStorage != nullptr;
+
+	std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor
+		<< ", multi draw indirect " << (multiDrawIndirect ? "on" : "off")
+		<< ", bindless textures " << (bindlessTextures ? "on" : "off")
+		<< ", vertex attrib binding " << (vertexAttribBinding ? "on" : "off")
+		<< ", buffer storage " << (bufferStorage ? "on" : "off") << std::endl;
+}
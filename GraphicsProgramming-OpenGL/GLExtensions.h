@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+
+// glad is generated for GL 3.3 core, entry points from newer versions are loaded here at
+// runtime. Every feature has a flag and callers keep a 3.3 path for when it is missing.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// Layout fixed by the GL spec for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void * indirect, GLsizei drawcount, GLsizei stride);
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLBINDVERTEXBUFFERPROC)(GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
+typedef void (APIENTRYP PFNGLVERTEXATTRIBFORMATPROC)(GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXATTRIBIFORMATPROC)(GLuint attribindex, GLint size, GLenum type, GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXATTRIBBINDINGPROC)(GLuint attribindex, GLuint bindingindex);
+typedef void (APIENTRYP PFNGLVERTEXBINDINGDIVISORPROC)(GLuint bindingindex, GLuint divisor);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void * data, GLbitfield flags);
+
+struct GLExtensions
+{
+	// GL 4.3 or ARB_multi_draw_indirect
+	static bool multiDrawIndirect;
+	static PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+
+	// ARB_bindless_texture, plus GL 4.3 for the storage buffer the handles live in
+	static bool bindlessTextures;
+	static PFNGLGETTEXTUREHANDLEARBPROC GetTextureHandleARB;
+	static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC MakeTextureHandleResidentARB;
+
+	// GL 4.3 or ARB_vertex_attrib_binding, attribute formats separate from the buffers
+	static bool vertexAttribBinding;
+	static PFNGLBINDVERTEXBUFFERPROC BindVertexBuffer;
+	static PFNGLVERTEXATTRIBFORMATPROC VertexAttribFormat;
+	static PFNGLVERTEXATTRIBIFORMATPROC VertexAttribIFormat;
+	static PFNGLVERTEXATTRIBBINDINGPROC VertexAttribBinding;
+	static PFNGLVERTEXBINDINGDIVISORPROC VertexBindingDivisor;
+
+	// GL 4.4 or ARB_buffer_storage, immutable buffers that can stay mapped
+	static bool bufferStorage;
+	static PFNGLBUFFERSTORAGEPROC BufferStorage;
+
+	// Call once after glad has loaded the core functions
+	static auto Load() -> void;
+};
@@ -0,0 +1,132 @@
+#include "GLState.h"
+
+GLStateCounters GLState::counters = GLStateCounters();
+unsigned int GLState::program_ = UNKNOWN;
+unsigned int GLState::vertexArray_ = UNKNOWN;
+unsigned int GLState::activeUnit_ = UNKNOWN;
+unsigned int GLState::textures_[GL_STATE_TEXTURE_UNITS] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+	UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };
+unsigned int GLState::framebuffer_ = UNKNOWN;
+int GLState::viewport_[4] = { -1, -1, -1, -1 };
+std::unordered_map<GLenum, bool> GLState::capabilities_;
+
+// Count the call and report whether it has to reach GL
+auto GLState::Changed(const bool changed) -> bool
+{
+	if (changed)
+	{
+		++counters.issued;
+		return true;
+	}
+
+	++counters.skipped;
+	return false;
+}
+
+auto GLState::UseProgram(const unsigned int program) -> void
+{
+	if (!Changed(program != program_)) return;
+
+	glUseProgram(program);
+	program_ = program;
+}
+
+auto GLState::BindVertexArray(const unsigned int vao) -> void
+{
+	if (!Changed(vao != vertexArray_)) return;
+
+	glBindVertexArray(vao);
+	vertexArray_ = vao;
+}
+
+auto GLState::BindTexture(const unsigned int unit, const unsigned int texture, const GLenum target) -> void
+{
+	if (!Changed(unit >= GL_STATE_TEXTURE_UNITS || texture != textures_[unit])) return;
+
+	if (unit != activeUnit_)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit_ = unit;
+	}
+
+	glBindTexture(target, texture);
+	if (unit < GL_STATE_TEXTURE_UNITS) textures_[unit] = texture;
+}
+
+auto GLState::ActiveTexture(const unsigned int unit) -> void
+{
+	if (!Changed(unit != activeUnit_)) return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit_ = unit;
+}
+
+auto GLState::BindFramebuffer(const unsigned int framebuffer) -> void
+{
+	if (!Changed(framebuffer != framebuffer_)) return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	framebuffer_ = framebuffer;
+}
+
+auto GLState::Viewport(const int x, const int y, const int width, const int height) -> void
+{
+	if (!Changed(x != viewport_[0] || y != viewport_[1] || width != viewport_[2] || height != viewport_[3])) return;
+
+	glViewport(x, y, width, height);
+	viewport_[0] = x;
+	viewport_[1] = y;
+	viewport_[2] = width;
+	viewport_[3] = height;
+}
+
+auto GLState::Enable(const GLenum capability) -> void
+{
+	SetCapability(capability, true);
+}
+
+auto GLState::Disable(const GLenum capability) -> void
+{
+	SetCapability(capability, false);
+}
+
+auto GLState::SetCapability(const GLenum capability, const bool enabled) -> void
+{
+	const auto found = capabilities_.find(capability);
+	if (!Changed(found == capabilities_.end() || found->second != enabled)) return;
+
+	if (enabled) glEnable(capability);
+	else glDisable(capability);
+	capabilities_[capability] = enabled;
+}
+
+auto GLState::DeleteTexture(const unsigned int texture) -> void
+{
+	glDeleteTextures(1, &texture);
+	for (auto& bound : textures_)
+	{
+		if (bound == texture) bound = 0;
+	}
+}
+
+auto GLState::DeleteFramebuffer(const unsigned int framebuffer) -> void
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	if (framebuffer_ == framebuffer) framebuffer_ = 0;
+}
+
+auto GLState::Invalidate() -> void
+{
+	program_ = UNKNOWN;
+	vertexArray_ = UNKNOWN;
+	activeUnit_ = UNKNOWN;
+	for (auto& texture : textures_) texture = UNKNOWN;
+	framebuffer_ = UNKNOWN;
+	for (auto& value : viewport_) value = -1;
+	capabilities_.clear();
+}
+
+auto GLState::ResetCounters() -> void
+{
+	counters = GLStateCounters();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <unordered_map>
+
+// Texture units tracked by the cache
+const unsigned int GL_STATE_TEXTURE_UNITS = 16;
+
+// Calls issued to GL and calls dropped because they would not have changed anything
+struct GLStateCounters
+{
+	unsigned int issued;
+	unsigned int skipped;
+};
+
+// Shadow copy of the bindings and capabilities the renderer changes. All binds of
+// programs, VAOs, textures and framebuffers must go through here, or the cache
+// must be told with Invalidate.
+class GLState
+{
+public:
+	static GLStateCounters counters;
+
+	static auto UseProgram(unsigned int program) -> void;
+	static auto BindVertexArray(unsigned int vao) -> void;
+	// Makes unit active only when the binding actually changes. Tracking is per unit, so
+	// a unit should only ever be used with one target.
+	static auto BindTexture(unsigned int unit, unsigned int texture, GLenum target = GL_TEXTURE_2D) -> void;
+	// Make unit active, for glTex* calls on the texture bound there
+	static auto ActiveTexture(unsigned int unit) -> void;
+	static auto BindFramebuffer(unsigned int framebuffer) -> void;
+	static auto Viewport(int x, int y, int width, int height) -> void;
+	static auto Enable(GLenum capability) -> void;
+	static auto Disable(GLenum capability) -> void;
+	// Delete through here: GL drops a deleted name from every binding point, and so must the
+	// cache, or a later object reusing the name would be taken as already bound
+	static auto DeleteTexture(unsigned int texture) -> void;
+	static auto DeleteFramebuffer(unsigned int framebuffer) -> void;
+
+	// Forget everything, the next call of each kind always reaches GL
+	static auto Invalidate() -> void;
+	static auto ResetCounters() -> void;
+
+private:
+	static unsigned int program_;
+	static unsigned int vertexArray_;
+	static unsigned int activeUnit_;
+	static unsigned int textures_[GL_STATE_TEXTURE_UNITS];
+	static unsigned int framebuffer_;
+	static int viewport_[4];
+	static std::unordered_map<GLenum, bool> capabilities_;
+
+	// Matches no real object, so the next bind always reaches GL
+	static const unsigned int UNKNOWN = ~0u;
+
+	static auto Changed(bool changed) -> bool;
+	static auto SetCapability(GLenum capability, bool enabled) -> void;
+};
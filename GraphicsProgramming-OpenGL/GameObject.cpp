@@ -1,68 +1,111 @@
 #include "GameObject.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "FrustumG.h"
-#include <iostream>
+#include "Bounds.h"
+#include "Scene.h"
 
 GameObject::GameObject(Model model, glm::vec3 initialPosition, glm::vec3 initialRotation, glm::vec3 initialScale)
 {
 	GameObject::model = model;
-	worldPosition = initialPosition;
-	worldRotation = initialRotation;
-	worldScale = initialScale;
+	worldPosition_ = initialPosition;
+	worldRotation_ = initialRotation;
+	worldScale_ = initialScale;
 }
 
-auto GameObject::Draw(Shader shaderProgram, FrustumG & frustum) -> void
+GameObject::GameObject(const GameObject& other) :
+	model(other.model), currentLod(other.currentLod), isStatic(other.isStatic),
+	worldPosition_(other.worldPosition_), worldRotation_(other.worldRotation_), worldScale_(other.worldScale_)
 {
-	auto draw = false;
-	// Check all points are inside the frustum
-	for (auto &mesh : model.meshes)
-	{
-		for (auto & vertex : mesh.vertices_)
-		{
-			if (frustum.pointInFrustum(vertex.Position) == FrustumG::INSIDE)
-			{
-				draw = true;
-				break;
-			}
-			if (draw) break;
-		}
-	}
+}
 
-//	if (!draw) return;
-	
-	if (!draw)
-		std::cout << "cull" << std::endl;
-	else
-		std::cout << "No Cull" << std::endl;
+auto GameObject::operator=(const GameObject& other) -> GameObject &
+{
+	model = other.model;
+	currentLod = other.currentLod;
+	isStatic = other.isStatic;
+	worldPosition_ = other.worldPosition_;
+	worldRotation_ = other.worldRotation_;
+	worldScale_ = other.worldScale_;
+	if (scene_ != nullptr) scene_->Changed();
+	return *this;
+}
 
-	auto modelMat = glm::mat4();
-	modelMat = glm::translate(modelMat, worldPosition);
-	modelMat = glm::scale(modelMat, worldScale);
-	shaderProgram.SetMat4("model", modelMat);
-	model.Draw(shaderProgram);
+// Object visibility is decided by the caller (see VisibilityCache), this culls the model's meshlets
+auto GameObject::Draw(Shader shaderProgram, FrustumG & frustum, const glm::vec3 & viewPosition, const bool updateCulling) -> void
+{
+	model.Draw(shaderProgram, frustum, GetModelMatrix(), viewPosition, currentLod, updateCulling);
 }
 
 
 auto GameObject::Draw(Shader shaderProgram) -> void
+{
+	model.Draw(shaderProgram, GetModelMatrix(), currentLod);
+}
+
+auto GameObject::GetModelMatrix() const -> glm::mat4
 {
 	auto modelMat = glm::mat4();
-	modelMat = glm::translate(modelMat, worldPosition);
-	modelMat = glm::scale(modelMat, worldScale);
-	shaderProgram.SetMat4("model", modelMat);
-	model.Draw(shaderProgram);
+	modelMat = glm::translate(modelMat, worldPosition_);
+	modelMat = glm::rotate(modelMat, glm::radians(worldRotation_.x), glm::vec3(1, 0, 0));
+	modelMat = glm::rotate(modelMat, glm::radians(worldRotation_.y), glm::vec3(0, 1, 0));
+	modelMat = glm::rotate(modelMat, glm::radians(worldRotation_.z), glm::vec3(0, 0, 1));
+	modelMat = glm::scale(modelMat, worldScale_);
+	return modelMat;
 }
 
-auto GameObject::Teleport(glm::vec3 position) -> void
+// World space AABB of the model's bounds
+auto GameObject::GetWorldBounds(glm::vec3 & min, glm::vec3 & max) const -> void
 {
+	TransformBounds(GetModelMatrix(), model.boundsMin, model.boundsMax, min, max);
+}
 
+auto GameObject::GetWorldBoundingSphere(glm::vec3 & center, float & radius) const -> void
+{
+	glm::vec3 min, max;
+	GetWorldBounds(min, max);
+	center = (min + max) * 0.5f;
+	radius = glm::length(max - min) * 0.5f;
 }
 
-auto GameObject::Rotate(glm::vec3 rotations) -> void
+auto GameObject::UpdateLod(const Camera & camera, const float fov, const float screenHeight) -> bool
 {
+	glm::vec3 center;
+	float radius;
+	GetWorldBoundingSphere(center, radius);
+
+	const auto screenSize = camera.ProjectedSize(center, radius, fov, screenHeight);
+	if (screenSize < MIN_SCREEN_SIZE) return false;
 
+	// Only switch once the size is clearly past a level's switch size to avoid popping
+	const auto lodCount = model.LodCount();
+	currentLod = glm::min(currentLod, lodCount - 1);
+	while (currentLod + 1 < lodCount && screenSize < model.LodSwitchSize(currentLod + 1) * (1.0f - LOD_HYSTERESIS))
+	{
+		++currentLod;
+	}
+	while (currentLod > 0 && screenSize > model.LodSwitchSize(currentLod) * (1.0f + LOD_HYSTERESIS))
+	{
+		--currentLod;
+	}
+
+	return true;
 }
 
-auto GameObject::Scale(glm::vec3 scale) -> void
+auto GameObject::Teleport(glm::vec3 position) -> void
 {
+	worldPosition_ = position;
+	if (scene_ != nullptr) scene_->Changed();
+}
 
+// Rotations are Euler angles in degrees, added to the current rotation
+auto GameObject::Rotate(glm::vec3 rotations) -> void
+{
+	worldRotation_ += rotations;
+	if (scene_ != nullptr) scene_->Changed();
+}
+
+auto GameObject::Scale(glm::vec3 scale) -> void
+{
+	worldScale_ = scale;
+	if (scene_ != nullptr) scene_->Changed();
 }
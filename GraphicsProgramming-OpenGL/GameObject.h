@@ -3,22 +3,56 @@
 #include "Mesh.h"
 #include "Model.h"
 #include "FrustumG.h"
+#include "Camera.h"
+
+class Scene;
+
+// Objects projecting to fewer pixels than this are not drawn
+const float MIN_SCREEN_SIZE = 2.0f;
+// Fraction a switch size must be crossed by before changing level of detail
+const float LOD_HYSTERESIS = 0.15f;
 
 class GameObject
 {
 public:
-	glm::vec3 worldPosition;
-	glm::vec3 worldRotation;
-	glm::vec3 worldScale;
 	Model model;
 
+	// Level of detail selected by UpdateLod
+	int currentLod = 0;
+
+	// Never moves after load, so its geometry may be merged into a StaticBatch
+	bool isStatic = false;
+
 	GameObject(Model model, glm::vec3 initialPosition, glm::vec3 initialRotation, glm::vec3 initialScale);
+	// Copies start outside any scene, assigning over an object in a scene counts as moving it
+	GameObject(const GameObject & other);
+	auto operator=(const GameObject & other) -> GameObject &;
 
-	auto Draw(Shader shaderProgram, FrustumG & frustum) -> void;
+	auto Draw(Shader shaderProgram, FrustumG & frustum, const glm::vec3 & viewPosition, bool updateCulling = true) -> void;
 	auto Draw(Shader shaderProgram) -> void;
 
+	auto GetPosition() const -> glm::vec3 { return worldPosition_; }
+	auto GetRotation() const -> glm::vec3 { return worldRotation_; }
+	auto GetScale() const -> glm::vec3 { return worldScale_; }
+	auto GetModelMatrix() const -> glm::mat4;
+	auto GetWorldBounds(glm::vec3 & min, glm::vec3 & max) const -> void;
+	auto GetWorldBoundingSphere(glm::vec3 & center, float & radius) const -> void;
+
+	// Pick the level of detail for the camera, false when too small to draw
+	auto UpdateLod(const Camera & camera, float fov, float screenHeight) -> bool;
+
 	auto Teleport(glm::vec3 position) -> void;
 	auto Rotate(glm::vec3 rotations) -> void;
 	auto Scale(glm::vec3 scale) -> void;
+
+private:
+	friend class Scene;
+
+	glm::vec3 worldPosition_;
+	glm::vec3 worldRotation_;
+	glm::vec3 worldScale_;
+
+	// Scene the object was last added to, told about every transform change
+	Scene * scene_ = nullptr;
 };
 
@@ -18,6 +18,25 @@
 #include <filesystem>
 #include "FrustumG.h"
 #include "GameObject.h"
+#include "Scene.h"
+#include "VisibilityCache.h"
+#include "Terrain.h"
+#include "RenderQueue.h"
+#include "MeshPool.h"
+#include "GLExtensions.h"
+#include "StaticBatch.h"
+#include "UniformBuffer.h"
+#include "Material.h"
+#include "GLState.h"
+#include "WorkerPool.h"
+#include "TripleBuffer.h"
+#include "FrameSnapshot.h"
+#include "RenderGraph.h"
+#include "FrameBenchmark.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 #include <windows.h>
 #include <mmsystem.h>
@@ -39,8 +58,19 @@ const auto fov = 55.0f;
 const auto nearCullDistance = 0.1f;
 const auto farCullDistance = 80.0f;
 
+// Seconds per simulation step
+const auto SIMULATION_STEP = 1.0 / 240.0;
+
 auto shadowMap = false;
 
+// Opaque geometry is drawn depth only first, then shaded with GL_EQUAL (P toggles)
+auto depthPrepass = false;
+auto depthPrepassKeyDown = false;
+
+// Presses of B, each runs the frame benchmark once
+auto benchmarkRequests = 0u;
+auto benchmarkKeyDown = false;
+
 // Camera Base
 auto _camera = Camera();
 
@@ -48,6 +78,10 @@ auto _camera = Camera();
 auto deltaTime = 0.0f;	// Time between current frame and last frame
 auto lastFrame = 0.0f; // Time of last frame
 
+// Framebuffer size, updated by the resize callback
+auto framebufferWidth = static_cast<int>(Screen_Width);
+auto framebufferHeight = static_cast<int>(Screen_Height);
+
 // Mouse Position
 auto mouseLastX = Screen_Width / 2;
 auto mouseLastY = Screen_Height / 2;
@@ -55,13 +89,11 @@ auto firstMousePoll = false;
 
 
 
-Mesh TerrainMaker(const float width, const float length, const float height, int wRes=256, int lRes=256)
+Terrain TerrainMaker(const float width, const float length, const float height, int wRes=256, int lRes=256)
 {
 	const auto Noise = siv::PerlinNoise();
 	const auto size = wRes * lRes;
 	auto vertices = std::vector<Vertex>(size);
-	auto normals = std::vector<glm::vec3>(size);
-	auto indices = std::vector<unsigned int>();
 
 	auto i = 0;
 	for (auto z = 0; z < lRes; ++z) for (auto x = 0; x < wRes; x++)
@@ -79,19 +111,6 @@ Mesh TerrainMaker(const float width, const float length, const float height, int
 		vertex.Position = v;
 		vertex.Normal = glm::vec3(0, 1, 0);
 		vertices[i] = vertex;
-		
-		if ((i + 1 % wRes) != 0 && z + 1 < lRes)
-		{
-//			auto tri = glm::ivec3(i, i + wRes, i + wRes + 1);
-//			auto tri2 = glm::ivec3(i, i + wRes + 1, i + 1);
-
-			indices.emplace_back(i);
-			indices.emplace_back(i + wRes);
-			indices.emplace_back(i + wRes + 1);
-			indices.emplace_back(i);
-			indices.emplace_back(i + wRes + 1);
-			indices.emplace_back(i + 1);
-		}
 
 		++i;
 	}
@@ -104,12 +123,18 @@ Mesh TerrainMaker(const float width, const float length, const float height, int
 	texture.path = "path";
 	textures.push_back(texture);
 	
-	return Mesh(vertices, indices, textures);
+	// Triangulated per chunk by the terrain's quadtree
+	return Terrain(vertices, wRes, lRes, textures);
 }
 
 
 int main(int argc, char* argv[])
 {
+	// --benchmark measures every rendering mode right after loading
+	for (auto arg = 1; arg < argc; ++arg)
+	{
+		if (std::string(argv[arg]) == "--benchmark") ++benchmarkRequests;
+	}
 
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -138,72 +163,134 @@ int main(int argc, char* argv[])
 		std::cout << "Failed to initialise GLAD" << std::endl;
 		return -1;
 	}
+	GLExtensions::Load();
 
 	// Global OpenGL Settings
-	glEnable(GL_DEPTH_TEST);
+	GLState::Enable(GL_DEPTH_TEST);
+	// Back faces are culled by default, double sided meshes turn it off for their own draws
+	GLState::Enable(GL_CULL_FACE);
 
 	// SHADER PROGRAMS
 //	auto lightingShader = Shader("shaders/lightingShader_vertex.shader", "shaders/lightingShader_fragment.shader");
-	auto modelShader = Shader("shaders/lightingShader_vertex.shader", "shaders/lightingShader_fragment.shader");
+	// Bindless materials read their textures from a handle table instead of bound units
+	auto modelShader = GLExtensions::bindlessTextures
+		? Shader("shaders/lightingShader_bindless_vertex.shader", "shaders/lightingShader_bindless_fragment.shader")
+		: Shader("shaders/lightingShader_vertex.shader", "shaders/lightingShader_fragment.shader");
 	auto lampShader = Shader("shaders/lampShader.vs", "shaders/lampShader.fs");
 	auto simpleDepthShader = Shader("shaders/shadowMap_vertex.shader", "shaders/shadowMap_Fragment.shader");
+	auto depthPrepassShader = Shader("shaders/depthPrepass_vertex.shader", "shaders/depthPrepass_fragment.shader");
+
+	// Material samplers read fixed texture units
+	modelShader.Use();
+	Material::AssignUnits(modelShader);
 
-	// Load house model
+	// Camera and light data are streamed every frame and shared by every program through
+	// fixed binding points, each Material owns the buffer for its own parameters
+	auto frameUniforms = StreamedUniformBuffer<FrameUniforms>(FRAME_UNIFORM_BINDING);
+	auto lightUniforms = StreamedUniformBuffer<LightUniforms>(LIGHT_UNIFORM_BINDING);
+
+	// Load house model, scenery stores 16 byte vertices
 	auto modelPath = std::experimental::filesystem::canonical("objects/house/Medieval_House.obj").string();
-	auto houseModel = Model(modelPath.c_str());
+	auto houseModel = Model(modelPath.c_str(), VertexLayout::Compact());
+	// The house shell is open and the grass is single sided cards, both keep their back faces
+	houseModel.SetDoubleSided(true);
+	houseModel.GenerateLods({ 300.0f, 100.0f });
 	auto houseObject = GameObject(houseModel, glm::vec3(0), glm::vec3(0), glm::vec3(0.02, 0.02, 0.02));
 
 	// Load lamp model
 	modelPath = std::experimental::filesystem::canonical("objects/grass.obj").string();
-	auto grassModel = Model(modelPath.c_str());
+	auto grassModel = Model(modelPath.c_str(), VertexLayout::Compact());
+	grassModel.SetDoubleSided(true);
+	grassModel.GenerateLods({ 300.0f, 100.0f });
 	auto grassObject = GameObject(grassModel, glm::vec3(0), glm::vec3(0), glm::vec3(10, 10, 10));
 
 	// Load lamp model
 	modelPath = std::experimental::filesystem::canonical("objects/cube.obj").string();
 	auto lampModel = Model(modelPath.c_str());
 
-	// Create terrain mesh (Perlin noise)
-	auto terrainMesh = TerrainMaker(15, 15, 2);
+	// Create terrain (Perlin noise)
+	auto terrain = TerrainMaker(15, 15, 2);
 
-	// Configure depth map FBO
+	// The shadow map is a transient of the render graph, only allocated while its pass runs
 	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
-
-	// create depth texture
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	const auto shadowMapDesc = RenderTextureDesc{ SHADOW_WIDTH, SHADOW_HEIGHT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, GL_NEAREST, GL_REPEAT };
+
+	// Sampled instead while the shadow pass is off, nothing is in shadow
+	const auto farDepth = 1.0f;
+	unsigned int noShadowMap;
+	glGenTextures(1, &noShadowMap);
+	GLState::BindTexture(0, noShadowMap);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 1, 1, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// Create frustrum for frustrum culling
 	auto frustum = FrustumG();
 	frustum.setCamInternals(fov, Screen_Width * 1.0 / Screen_Height, nearCullDistance, farCullDistance);
 
+	houseObject.isStatic = true;
+	grassObject.isStatic = true;
+
+	// Without multi draw indirect the static objects are merged per material and chunk instead
+	const auto staticBatching = !GLExtensions::multiDrawIndirect;
+	auto staticBatch = StaticBatch();
+
+	// Light frustum and the objects that cast into the shadow map
+	auto lightFrustum = FrustumG();
+	auto shadowCasters = std::vector<GameObject *>();
+
+	// Objects drawn in the main pass
+	auto scene = Scene();
+
+	if (staticBatching)
+	{
+		staticBatch.Build({ &houseObject, &grassObject });
+	}
+	else
+	{
+		shadowCasters = { &houseObject, &grassObject };
+		scene.Add(&houseObject);
+		scene.Add(&grassObject);
+	}
+
+	// Every mesh lives in the vertex and index heaps of its layout's pool, so the queue can
+	// multi draw them. Loading leaves gaps behind from temporary meshes and replaced levels
+	// of detail, close them before the first frame.
+	for (auto pool : MeshPool::All())
+	{
+		pool->Defragment();
+		const auto poolStats = pool->Stats();
+		std::cout << "Mesh pool (" << pool->Layout().Stride() << " byte vertices): " << poolStats.vertices.used << "/" << poolStats.vertices.capacity << " vertices, "
+			<< poolStats.indices.used << "/" << poolStats.indices.capacity << " indices, "
+			<< poolStats.shortIndices.used << "/" << poolStats.shortIndices.capacity << " 16 bit indices in "
+			<< poolStats.vertices.allocations << " meshes, " << poolStats.vertexBytes / 1024 << " KiB of vertices" << std::endl;
+	}
+	auto visibilityCache = VisibilityCache();
+
+
+	// Draws are sorted by program, textures, vertex buffer and depth before they are issued
+	auto renderQueue = RenderQueue();
+	auto shadowQueue = RenderQueue();
+
+	// Culling and draw list recording run on the workers, each filling its own queue
+	WorkerPool workers;
+	auto workerQueues = std::vector<RenderQueue>(workers.ThreadCount());
+	std::cout << "Worker threads: " << workers.ThreadCount() << std::endl;
+
 
 	// 'Game' Music
 	PlaySound("africa.wav", nullptr, SND_FILENAME | SND_ASYNC);
 
 
-	// VAO and VBO for the Emission Cube (Legacy object method)
+	// Vertex data for the Emission Cube
 	float vertices[] = {
 		// positions          // normals           // texture coords
 		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-		0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
 		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+		0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
 		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
 		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
 
 		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
 		0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
@@ -220,11 +307,11 @@ int main(int argc, char* argv[])
 		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
 
 		0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-		0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
 		0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+		0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
 		0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
 		0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+		0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
 
 		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
 		0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
@@ -234,197 +321,399 @@ int main(int argc, char* argv[])
 		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
 
 		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-		0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
 		0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+		0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
 		0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f
 	};
 
 
-	unsigned int VBO, cubeVAO;
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &VBO);
+	const auto diffuseMap = LoadTexture("textures/container2.png");
+	const auto specularMap = LoadTexture("textures/container2_specular.png");
+	const auto emissionMap = LoadTexture("textures/emission.jpg");
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	// Build a mesh from the interleaved cube data so the ring can be drawn instanced
+	auto cubeVertices = std::vector<Vertex>();
+	auto cubeIndices = std::vector<unsigned int>();
+	for (auto v = 0u; v < sizeof(vertices) / sizeof(float) / 8; ++v)
+	{
+		auto vertex = Vertex();
+		vertex.Position = glm::vec3(vertices[v * 8], vertices[v * 8 + 1], vertices[v * 8 + 2]);
+		vertex.Normal = glm::vec3(vertices[v * 8 + 3], vertices[v * 8 + 4], vertices[v * 8 + 5]);
+		vertex.TexCoords = glm::vec2(vertices[v * 8 + 6], vertices[v * 8 + 7]);
+		cubeVertices.push_back(vertex);
+		cubeIndices.push_back(v);
+	}
 
-	// Bind vertex attribute object first and set vertex buffers then configure vertex attributes
-	glBindVertexArray(cubeVAO);
+	auto cubeTextures = std::vector<Texture>(3);
+	cubeTextures[0].id = diffuseMap;
+	cubeTextures[0].type = "texture_diffuse";
+	cubeTextures[1].id = specularMap;
+	cubeTextures[1].type = "texture_specular";
+	cubeTextures[2].id = emissionMap;
+	cubeTextures[2].type = "texture_emission";
+	auto cubeMesh = Mesh(cubeVertices, cubeIndices, cubeTextures);
+
+	// Every material exists now, make their textures resident or pack them into arrays
+	auto textureArrays = TextureArrays();
+	if (GLExtensions::bindlessTextures)
+	{
+		Material::SetResidency(RESIDENCY_BINDLESS);
+	}
+	else
+	{
+		textureArrays.Build(Material::AllTextures(), ARRAY_UNIT_OFFSET);
+		Material::SetResidency(RESIDENCY_ARRAYS, &textureArrays);
+		std::cout << "Packed material textures into " << textureArrays.ArrayCount() << " texture arrays" << std::endl;
+	}
 
-	// Position Attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), static_cast<void *>(nullptr));
-	glEnableVertexAttribArray(0);
-	// Normal Attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void *>(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// Texture Attribute
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void *>(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	// The simulation publishes a snapshot per step, the render thread draws the newest one
+	TripleBuffer<FrameSnapshot> snapshots;
+	std::atomic<bool> rendering(true);
 
-	const auto diffuseMap = LoadTexture("textures/container2.png");
-	const auto specularMap = LoadTexture("textures/container2_specular.png");
-	const auto emissionMap = LoadTexture("textures/emission.jpg");
+	// Window titles can only be set from this thread
+	std::mutex titleMutex;
+	auto windowTitle = std::string();
 
 	//
-	// ──────────────────────────────────────────────────────────────────────────────── V ──────────
-	//   :::::: A P P L I C A T I O N   M A I N L O O P : :  :   :    :     :        :          :
-	// ──────────────────────────────────────────────────────────────────────────────────────────
+	// ─── RENDER THREAD ──────────────────────────────────────────────────────────────
 	//
-	while(!glfwWindowShouldClose(window))
+	// Owns the GL context from here on, nothing on this thread may call GL any more
+	glfwMakeContextCurrent(nullptr);
+	auto renderThread = std::thread([&]
 	{
-		// lighting
-		const auto lightPos = glm::vec3(sin(glfwGetTime()) * 5, 10, -sin(glfwGetTime()) * 5);
+		glfwMakeContextCurrent(window);
+		auto statsTime = 0.0;
 
-		// Timing
-		const float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+		// Created here so their GL objects are deleted while the context is still current
+		RenderGraph renderGraph;
+		FrameBenchmark benchmark;
+		auto benchmarkRequestsSeen = 0u;
 
-		ProcessInput(window);
-
-		// -- Render ---------------------------------------------------------------
-		glm::mat4 model;
-		glm::mat4 lightSpaceMatrix;
-		
-		if (shadowMap)
+		while (rendering.load())
 		{
-			//
-			// ─── DEPTH MAP PASS ──────────────────────────────────────────────
-			//
-			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// Without a newer step the last snapshot is drawn again
+			snapshots.Acquire();
+			const auto& frame = snapshots.Front();
+			if (frame.step == 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Dynamic data of this frame goes to the next stream partition the GPU is done with
+			StreamBuffer::Shared().BeginFrame();
+			benchmark.BeginFrame();
+
+			// The benchmark renders each mode in turn, overriding the toggle
+			if (frame.benchmarkRequests != benchmarkRequestsSeen)
+			{
+				benchmarkRequestsSeen = frame.benchmarkRequests;
+				benchmark.Start({ "forward", "depth pre-pass" });
+				std::cout << "Frame benchmark started" << std::endl;
+			}
+			const auto benchmarking = benchmark.Running();
+			const auto prepass = benchmarking ? benchmark.CurrentCase() == 1 : frame.depthPrepass;
+
+			// Redundant state changes removed by the cache last frame
+			const auto stateCounters = GLState::counters;
+			GLState::ResetCounters();
+
+			// Set the frustrum
+			const auto& camera = frame.camera;
+			const auto& lightPos = frame.lightPos;
+			const auto shadowMap = frame.shadowMap;
+			const auto camPosition = camera.Position;
+			const auto facing = camera.Front + camera.Position;
+			const auto cameraUp = camera.Up;
+
+			frustum.setCamDef(camPosition, facing, cameraUp);
+
+			// -- Render ---------------------------------------------------------------
+			glm::mat4 model;
+
+			// View, projection and light transformations
+			const auto projection = glm::perspective(glm::radians(fov), Screen_Width / Screen_Height, nearCullDistance, farCullDistance);
+			const auto view = camera.GetViewMatrix();
 
 			const auto near_plane = 0.1f;
 			const auto far_plane = 10.0f;
-			const auto lightProjection = glm::ortho(10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
+			const auto lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
 			const auto lightView = glm::lookAt(lightPos, glm::vec3(0), glm::vec3(0.0, 1.0, 0.0));
-			lightSpaceMatrix = lightProjection * lightView;
-
-			simpleDepthShader.Use();
-			simpleDepthShader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-			glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-			glClear(GL_DEPTH_BUFFER_BIT);
+			const auto lightSpaceMatrix = lightProjection * lightView;
 
+			// One write each for everything the programs share this frame
+			frameUniforms.Update(FrameUniforms{ view, projection, lightSpaceMatrix, camera.Position, static_cast<float>(frame.time) });
+			lightUniforms.Update(LightUniforms{ glm::vec4(lightPos, 1.0f), glm::vec4(0.2f), glm::vec4(0.5f), glm::vec4(1.0f) });
+		
+			//
+			// ─── DRAW LISTS ──────────────────────────────────────────────────
+			//
+			// Nothing here touches GL, the passes below only execute the sorted queues
+			if (shadowMap)
+			{
+				// Casters are extruded along the light direction through the light's depth range
+				lightFrustum.setFromMatrix(lightSpaceMatrix);
+				auto shadowSweep = glm::normalize(glm::vec3(0) - lightPos) * (far_plane - near_plane);
+
+				shadowQueue.Begin(PASS_SHADOW, lightPos, far_plane);
+				for (auto caster : shadowCasters)
+				{
+					glm::vec3 casterMin, casterMax;
+					caster->GetWorldBounds(casterMin, casterMax);
+
+					// Outside the light's frustum it can't write to the shadow map
+					if (lightFrustum.boxInFrustum(casterMin, casterMax) == FrustumG::OUTSIDE)
+						continue;
+
+					// Its shadow can't reach anything the camera sees
+					if (frustum.sweptBoxInFrustum(casterMin, casterMax, shadowSweep) == FrustumG::OUTSIDE)
+						continue;
+
+					caster->Draw(simpleDepthShader);
+				}
+
+				for (auto& chunk : staticBatch.chunks)
+				{
+					if (lightFrustum.boxInFrustum(chunk.boundsMin, chunk.boundsMax) == FrustumG::OUTSIDE)
+						continue;
+					if (frustum.sweptBoxInFrustum(chunk.boundsMin, chunk.boundsMax, shadowSweep) == FrustumG::OUTSIDE)
+						continue;
+
+					chunk.mesh.Draw(simpleDepthShader, glm::mat4(1.0f));
+				}
+				shadowQueue.End();
+			}
+
+			// Culling and LOD selection are skipped while the camera and scene are static
+			const auto& visibleObjects = visibilityCache.Update(scene, camera, frustum, fov, Screen_Height, &workers);
+			const auto updateCulling = !visibilityCache.Reused();
+
+			// Every object's meshlets are culled by whichever worker records it
+			workers.ParallelFor(static_cast<unsigned int>(visibleObjects.size()), WORKER_CHUNK_SIZE,
+				[&](const unsigned int begin, const unsigned int end, const unsigned int worker)
+			{
+				auto& queue = workerQueues[worker];
+				queue.Begin(PASS_OPAQUE, camPosition, farCullDistance);
+				for (auto i = begin; i < end; ++i)
+				{
+					visibleObjects[i]->Draw(modelShader, frustum, camPosition, updateCulling);
+				}
+				queue.End();
+			});
+
+			renderQueue.Begin(PASS_OPAQUE, camPosition, farCullDistance);
+			staticBatch.Draw(modelShader, frustum, camPosition);
+
+			// Draw the terrain
+			model = glm::mat4(1);
+			model = glm::translate(model, glm::vec3(25, 0, 25));
+			model = glm::scale(model, glm::vec3(3, 3, 3));
+			terrain.Draw(modelShader, frustum, model);
+			renderQueue.End();
+
+			for (auto& queue : workerQueues)
+			{
+				renderQueue.Append(queue);
+			}
+
+			// Both queues sort at once
+			workers.ParallelFor(2, 1, [&](const unsigned int begin, unsigned int, unsigned int)
+			{
+				(begin == 0 ? renderQueue : shadowQueue).Prepare();
+			});
 
-			houseObject.Draw(simpleDepthShader);
-			grassObject.Draw(simpleDepthShader);
-			
-
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		}
-
-		//
-		// ─── RENDER PASS ─────────────────────────────────────────────────
-		//
-		glViewport(0, 0, Screen_Width, Screen_Height);
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		modelShader.Use();
-
-		// View and projection transformations
-		const auto projection = glm::perspective(glm::radians(fov), Screen_Width / Screen_Height, nearCullDistance, farCullDistance);
-		const auto view = _camera.GetViewMatrix();
-		modelShader.SetMat4("view", view);
-		modelShader.SetMat4("projection", projection);
-
-		if (shadowMap)
-		{
-			modelShader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_2D, depthMap);
+			//
+			// ─── PASSES ──────────────────────────────────────────────────────
+			//
+			// The shadow pass is culled by the graph unless the lit pass reads its output
+			renderGraph.Reset();
+			const auto backbuffer = renderGraph.ImportBackbuffer("backbuffer", frame.framebufferWidth, frame.framebufferHeight);
+			const auto shadowTexture = renderGraph.CreateTexture("shadow map", shadowMapDesc);
+			const auto noShadowTexture = renderGraph.ImportTexture("no shadow", noShadowMap, 1, 1);
+
+			renderGraph.AddPass("shadow depth", {}, { shadowTexture }, [&](const RenderGraph&)
+			{
+				glClear(GL_DEPTH_BUFFER_BIT);
+				shadowQueue.ExecuteDepth(simpleDepthShader);
+				shadowQueue.Clear();
+			});
+
+			const auto shadowInput = shadowMap ? shadowTexture : noShadowTexture;
+			// Lays down the depth of the opaque queue, so the lit pass shades each pixel once
+			if (prepass)
+			{
+				renderGraph.AddPass("depth prepass", {}, { backbuffer }, [&](const RenderGraph&)
+				{
+					glClear(GL_DEPTH_BUFFER_BIT);
+					glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+					renderQueue.ExecuteDepth(depthPrepassShader);
+					glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+				});
+			}
+
+			renderGraph.AddPass("lit", { shadowInput }, { backbuffer }, [&](const RenderGraph& graph)
+			{
+				glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+				glClear(prepass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				modelShader.Use();
+				GLState::BindTexture(SHADOW_MAP_UNIT, graph.Texture(shadowInput));
+
+				if (prepass)
+				{
+					glDepthFunc(GL_EQUAL);
+					glDepthMask(GL_FALSE);
+				}
+				renderQueue.Execute();
+				if (prepass)
+				{
+					// The cubes below were not in the pre-pass
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+				}
+
+				// The cube material's emission map pulses
+				cubeMesh.material_->emissionIntensity = frame.emissionIntensity;
+				cubeMesh.material_->Update();
+
+				// Render the cube circle in one instanced draw
+				cubeMesh.DrawInstanced(modelShader, frame.cubeTransforms);
+			});
+
+			renderGraph.AddPass("lamp", {}, { backbuffer }, [&](const RenderGraph&)
+			{
+				lampShader.Use();
+				model = glm::mat4();
+				model = glm::translate(model, lightPos);
+				model = glm::scale(model, glm::vec3(0.2f));
+
+				lampShader.SetMat4("model", model);
+				lampModel.Draw(lampShader);
+			});
+
+			renderGraph.Compile();
+			renderGraph.Execute();
+
+			// Show the opaque pass state changes once a second
+			if (frame.time - statsTime > 1.0)
+			{
+				statsTime = frame.time;
+				const auto& stats = renderQueue.stats;
+				const auto graphStats = renderGraph.Stats();
+				const auto title = "Graphics Programming | draws " + std::to_string(stats.draws)
+					+ " programs " + std::to_string(stats.programChanges)
+					+ " materials " + std::to_string(stats.materialChanges)
+					+ " pools " + std::to_string(stats.poolChanges)
+					+ " pooled " + std::to_string(stats.pooledPackets) + "/" + std::to_string(stats.packets)
+					+ " | state calls " + std::to_string(stateCounters.issued) + " skipped " + std::to_string(stateCounters.skipped)
+					+ " | passes " + std::to_string(graphStats.passes - graphStats.culledPasses) + "/" + std::to_string(graphStats.passes)
+					+ (prepass ? " pre-pass" : "")
+					+ " | gpu " + std::to_string(benchmark.GpuMilliseconds()) + " ms";
+				std::lock_guard<std::mutex> lock(titleMutex);
+				windowTitle = title;
+			}
+
+			benchmark.EndFrame();
+			if (benchmarking && !benchmark.Running())
+			{
+				benchmark.Report(std::cout);
+			}
+
+			StreamBuffer::Shared().EndFrame();
+
+			// Waits for vsync without holding up the simulation
+			glfwSwapBuffers(window);
 		}
 
-		modelShader.SetVec3("light.position", lightPos);
-		modelShader.SetVec3("viewPosition", _camera.Position);
-		modelShader.SetVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-		modelShader.SetVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-		modelShader.SetVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		modelShader.SetFloat("material.shininess", 32.0f);
-
-		// Set the frustrum
-		const auto camPosition = glm::vec3(_camera.GetPosition());
-		const auto facing = glm::vec3(_camera.GetFront() + _camera.GetPosition());
-		const auto cameraUp = glm::vec3(_camera.GetUp());
+		glfwMakeContextCurrent(nullptr);
+	});
 
-		frustum.setCamDef(camPosition, facing, cameraUp);
-
-		houseObject.Draw(modelShader, frustum);
-		grassObject.Draw(modelShader, frustum);
-
-		// Draw the terrain
-		model = glm::mat4(1);
-		model = glm::translate(model, glm::vec3(25, 0, 25));
-		model = glm::scale(model, glm::vec3(3, 3, 3));
-		modelShader.SetMat4("model", model);
-		terrainMesh.Draw(modelShader);
-
-		// Draw the Emission cube -------------------
-		modelShader.SetFloat("time", glfwGetTime());
+	//
+	// ──────────────────────────────────────────────────────────────────────────────── V ──────────
+	//   :::::: A P P L I C A T I O N   M A I N L O O P : :  :   :    :     :        :          :
+	// ──────────────────────────────────────────────────────────────────────────────────────────
+	//
+	// Input, camera and animation at a fixed step rate, independent of the display
+	auto step = 0ull;
+	auto nextStep = glfwGetTime();
+	while(!glfwWindowShouldClose(window))
+	{
+		// Timing
+		const float currentFrame = glfwGetTime();
+		deltaTime = currentFrame - lastFrame;
+		lastFrame = currentFrame;
 
-		// Bind defuse map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
+		glfwPollEvents();
+		ProcessInput(window);
 
-		// Bind specular map
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
+		auto& snapshot = snapshots.Back();
+		snapshot.step = ++step;
+		snapshot.time = currentFrame;
+		snapshot.camera = _camera;
+		snapshot.framebufferWidth = framebufferWidth;
+		snapshot.framebufferHeight = framebufferHeight;
+		snapshot.shadowMap = shadowMap;
+		snapshot.depthPrepass = depthPrepass;
+		snapshot.benchmarkRequests = benchmarkRequests;
 
-		// Bind Emission Map
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, emissionMap);
+		// lighting
+		snapshot.lightPos = glm::vec3(sin(currentFrame) * 5, 10, -sin(currentFrame) * 5);
 
-		modelShader.SetInt("material.texture_diffuse1", 0);
-		modelShader.SetInt("material.texture_specular1", 1);
-		modelShader.SetInt("material.emission", 2);
-		modelShader.SetFloat("emissionIntensity", sin(glfwGetTime()));
+		// The cube material's emission map pulses
+		snapshot.emissionIntensity = static_cast<float>(sin(currentFrame));
 
-		// Render the cube circle
+		// The cube circle
 		const auto numberOfCubes = 10;
 		const auto radius = 5;
+		snapshot.cubeTransforms.clear();
 		for (auto i = 0; i < numberOfCubes; ++i)
 		{
 			auto x = radius * cos(2 * 3.14159262 * i / numberOfCubes);
 			auto z = radius * sin(2 * 3.14159262 * i / numberOfCubes);
 
-			model = glm::mat4(1.0f);
+			// Skip cubes smaller than a couple of pixels (unit cube bounding sphere)
+			if (_camera.ProjectedSize(glm::vec3(x, 1, z), 0.87f, fov, Screen_Height) < MIN_SCREEN_SIZE)
+				continue;
+
+			auto model = glm::mat4(1.0f);
 
 			model = glm::translate(model, glm::vec3(x, 1, z));
-			model = glm::rotate(model, glm::radians(static_cast<float>(glfwGetTime() * 10)), glm::vec3(1, 0, 0));
-			model = glm::rotate(model, glm::radians(static_cast<float>(glfwGetTime() * 10)), glm::vec3(0, 1, 0));
+			model = glm::rotate(model, glm::radians(currentFrame * 10), glm::vec3(1, 0, 0));
+			model = glm::rotate(model, glm::radians(currentFrame * 10), glm::vec3(0, 1, 0));
 			model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0, 0, 1));
 			model = glm::scale(model, glm::vec3(1, 1, 1));
 
-			modelShader.SetMat4("model", model);
-			glBindVertexArray(cubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			snapshot.cubeTransforms.push_back(model);
 		}
 
-		// Reset sampler uniforms for other models
-		modelShader.SetInt("material.texture_diffuse1", 0);
-		modelShader.SetInt("material.texture_specular1", 1);
-		modelShader.SetInt("material.emission", 3);
-
-		// Render the lamp object
-		lampShader.Use();
-		model = glm::mat4();
-		model = glm::translate(model, lightPos);
-		model = glm::scale(model, glm::vec3(0.2f));
-
-		lampShader.SetMat4("projection", projection);
-		lampShader.SetMat4("view", view);
-		lampShader.SetMat4("model", model);
-
+		snapshots.Publish();
 
-		lampModel.Draw(lampShader);
+		{
+			std::lock_guard<std::mutex> lock(titleMutex);
+			if (!windowTitle.empty())
+			{
+				glfwSetWindowTitle(window, windowTitle.c_str());
+				windowTitle.clear();
+			}
+		}
 
-		// -- Swap buffers and poll IO --------------------------------------------- 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		// Sleep off the rest of the step, a late step starts the next one right away
+		nextStep += SIMULATION_STEP;
+		const auto remaining = nextStep - glfwGetTime();
+		if (remaining > 0.0)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+		}
+		else
+		{
+			nextStep = glfwGetTime();
+		}
 	}
 
+	rendering.store(false);
+	renderThread.join();
+
 	glfwTerminate();
 	return 0;
 }
@@ -467,6 +756,21 @@ auto ProcessInput(GLFWwindow* window) -> void
 		shadowMap = true;
 	}
 
+	// Toggles act on the press, not while the key is held
+	const auto prepassKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+	if (prepassKey && !depthPrepassKeyDown)
+	{
+		depthPrepass = !depthPrepass;
+	}
+	depthPrepassKeyDown = prepassKey;
+
+	const auto benchmarkKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+	if (benchmarkKey && !benchmarkKeyDown)
+	{
+		++benchmarkRequests;
+	}
+	benchmarkKeyDown = benchmarkKey;
+
 }
 
 auto mouse_callback(GLFWwindow* window, double xpos, double ypos) -> void
@@ -486,9 +790,11 @@ auto mouse_callback(GLFWwindow* window, double xpos, double ypos) -> void
 }
 
 
+// Runs on the main thread, the render thread picks the size up from the next snapshot
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	framebufferWidth = width;
+	framebufferHeight = height;
 }
 
 
@@ -515,7 +821,7 @@ auto LoadTexture(const char * path) -> unsigned int
 			format = GL_RGBA;
 
 		// Bind the texture
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::BindTexture(0, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, imageData);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -0,0 +1,218 @@
+#include "Material.h"
+#include <glad/glad.h>
+#include "GLState.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+unsigned int Material::nextId_ = 0;
+// Defined before the registry so it outlives it, materials destroyed with the registry at
+// exit still remove themselves from it
+std::vector<Material *> Material::live_;
+std::vector<std::shared_ptr<Material>> Material::registry_;
+Texture_Residency Material::residency_ = RESIDENCY_BIND;
+const TextureArrays * Material::arrays_ = nullptr;
+unsigned int Material::tableBuffer_ = 0;
+unsigned int Material::tableEntries_ = 0;
+
+namespace
+{
+	auto SlotOf(const std::string & type) -> int
+	{
+		if (type == "texture_diffuse") return SLOT_DIFFUSE;
+		if (type == "texture_specular") return SLOT_SPECULAR;
+		if (type == "texture_emission") return SLOT_EMISSION;
+		if (type == "texture_normal") return SLOT_NORMAL;
+		if (type == "texture_height") return SLOT_HEIGHT;
+		return -1;
+	}
+
+	// The first texture of each type fills its slot
+	auto ResolveSlots(const std::vector<Texture> & textures, unsigned int (&slots)[MATERIAL_SLOT_COUNT]) -> void
+	{
+		for (auto& texture : textures)
+		{
+			const auto slot = SlotOf(texture.type);
+			if (slot >= 0 && slots[slot] == 0)
+			{
+				slots[slot] = texture.id;
+			}
+		}
+	}
+
+	// Slots that have a texture array or bindless counterpart, in table order
+	const Material_Slot ARRAY_SLOTS[ARRAY_SLOT_COUNT] = { SLOT_DIFFUSE, SLOT_SPECULAR, SLOT_EMISSION };
+
+	// A handle may only be made resident once
+	std::unordered_set<GLuint64> residentHandles;
+}
+
+Material::Material(const std::vector<Texture>& textures, const float shininess) :
+	shininess(shininess), id(nextId_++), uniforms_(MATERIAL_UNIFORM_BINDING)
+{
+	ResolveSlots(textures, Material::textures);
+	live_.push_back(this);
+	Resolve();
+
+	// The table is indexed by id, so it grows with every new material
+	if (residency_ == RESIDENCY_BINDLESS) UploadTable();
+}
+
+Material::~Material()
+{
+	live_.erase(std::remove(live_.begin(), live_.end(), this), live_.end());
+}
+
+// Look up layers or handles for the current residency mode
+auto Material::Resolve() -> void
+{
+	useArrays_ = residency_ == RESIDENCY_ARRAYS && arrays_ != nullptr;
+	for (unsigned int i = 0; i < ARRAY_SLOT_COUNT; ++i)
+	{
+		const auto texture = textures[ARRAY_SLOTS[i]];
+
+		layers_[i] = arrays_ != nullptr ? arrays_->Find(texture) : TextureLayer{ 0, -1 };
+		if (texture != 0 && layers_[i].layer < 0) useArrays_ = false;
+
+		handles_[i] = 0;
+		if (residency_ == RESIDENCY_BINDLESS && texture != 0)
+		{
+			handles_[i] = GLExtensions::GetTextureHandleARB(texture);
+			if (residentHandles.insert(handles_[i]).second)
+			{
+				GLExtensions::MakeTextureHandleResidentARB(handles_[i]);
+			}
+		}
+	}
+
+	Update();
+}
+
+auto Material::Update() -> void
+{
+	auto data = MaterialUniforms();
+	data.shininess = shininess;
+	data.emissionIntensity = emissionIntensity;
+	data.textureArrays = useArrays_ ? 1 : 0;
+	for (unsigned int i = 0; i < ARRAY_SLOT_COUNT; ++i)
+	{
+		data.layers[i] = layers_[i].layer;
+	}
+	uniforms_.Update(data);
+
+	if (residency_ == RESIDENCY_BINDLESS && id < tableEntries_)
+	{
+		auto entry = MaterialTableEntry{ { handles_[0], handles_[1], handles_[2] }, shininess, emissionIntensity };
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, tableBuffer_);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, id * sizeof(MaterialTableEntry), sizeof(MaterialTableEntry), &entry);
+	}
+}
+
+auto Material::Bind(const Shader& shader) const -> void
+{
+	if (residency_ == RESIDENCY_BINDLESS)
+	{
+		shader.SetInt("materialIndex", static_cast<int>(id));
+		return;
+	}
+
+	if (useArrays_)
+	{
+		for (unsigned int i = 0; i < ARRAY_SLOT_COUNT; ++i)
+		{
+			// Slots without a texture leave whatever array is bound, the shader skips layer -1
+			if (layers_[i].layer >= 0) GLState::BindTexture(ARRAY_UNIT_OFFSET + i, layers_[i].array, GL_TEXTURE_2D_ARRAY);
+		}
+	}
+	else
+	{
+		for (unsigned int unit = 0; unit < MATERIAL_SLOT_COUNT; ++unit)
+		{
+			if (unit == SHADOW_MAP_UNIT) continue;
+
+			GLState::BindTexture(unit, textures[unit]);
+		}
+	}
+
+	uniforms_.Bind();
+}
+
+auto Material::AssignUnits(const Shader& shader) -> void
+{
+	shader.SetInt("material.texture_diffuse1", SLOT_DIFFUSE);
+	shader.SetInt("material.texture_specular1", SLOT_SPECULAR);
+	shader.SetInt("material.emission", SLOT_EMISSION);
+	shader.SetInt("material.texture_normal1", SLOT_NORMAL);
+	shader.SetInt("material.texture_height1", SLOT_HEIGHT);
+	shader.SetInt("material.diffuseArray", ARRAY_UNIT_OFFSET + 0);
+	shader.SetInt("material.specularArray", ARRAY_UNIT_OFFSET + 1);
+	shader.SetInt("material.emissionArray", ARRAY_UNIT_OFFSET + 2);
+	shader.SetInt("shadowMap", SHADOW_MAP_UNIT);
+}
+
+auto Material::Get(const std::vector<Texture>& textures) -> std::shared_ptr<Material>
+{
+	unsigned int slots[MATERIAL_SLOT_COUNT] = {};
+	ResolveSlots(textures, slots);
+
+	for (auto& material : registry_)
+	{
+		if (std::equal(std::begin(slots), std::end(slots), std::begin(material->textures)))
+		{
+			return material;
+		}
+	}
+
+	registry_.push_back(std::make_shared<Material>(textures));
+	return registry_.back();
+}
+
+auto Material::SetResidency(const Texture_Residency residency, const TextureArrays* arrays) -> void
+{
+	residency_ = residency == RESIDENCY_BINDLESS && !GLExtensions::bindlessTextures ? RESIDENCY_BIND : residency;
+	arrays_ = arrays;
+
+	for (auto material : live_)
+	{
+		material->Resolve();
+	}
+
+	if (residency_ == RESIDENCY_BINDLESS) UploadTable();
+}
+
+auto Material::Residency() -> Texture_Residency
+{
+	return residency_;
+}
+
+auto Material::AllTextures() -> std::vector<unsigned int>
+{
+	auto textures = std::vector<unsigned int>();
+	for (auto material : live_)
+	{
+		textures.insert(textures.end(), std::begin(material->textures), std::end(material->textures));
+	}
+
+	std::sort(textures.begin(), textures.end());
+	textures.erase(std::unique(textures.begin(), textures.end()), textures.end());
+	textures.erase(std::remove(textures.begin(), textures.end(), 0u), textures.end());
+	return textures;
+}
+
+// Rewrite the whole table, entries of destroyed materials stay empty
+auto Material::UploadTable() -> void
+{
+	auto table = std::vector<MaterialTableEntry>(nextId_, MaterialTableEntry{});
+	for (auto material : live_)
+	{
+		table[material->id] = MaterialTableEntry{ { material->handles_[0], material->handles_[1], material->handles_[2] },
+			material->shininess, material->emissionIntensity };
+	}
+
+	if (tableBuffer_ == 0) glGenBuffers(1, &tableBuffer_);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, tableBuffer_);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, table.size() * sizeof(MaterialTableEntry), table.data(), GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, tableBuffer_);
+	tableEntries_ = nextId_;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Texture.h"
+#include "Shader.h"
+#include "UniformBuffer.h"
+#include "TextureArrays.h"
+
+// Texture unit of each material slot, the same for every program
+enum Material_Slot
+{
+	SLOT_DIFFUSE = 0,
+	SLOT_SPECULAR = 1,
+	SLOT_EMISSION = 2,
+	SLOT_NORMAL = 4,
+	SLOT_HEIGHT = 5
+};
+
+// Unit 3 belongs to the shadow map, materials leave it alone
+const unsigned int SHADOW_MAP_UNIT = 3;
+const unsigned int MATERIAL_SLOT_COUNT = 6;
+
+// Diffuse, specular and emission array samplers use their own units (6, 7, 8), so every
+// unit only ever sees one texture target
+const unsigned int ARRAY_UNIT_OFFSET = 6;
+const unsigned int ARRAY_SLOT_COUNT = 3;
+
+// Storage buffer binding of the bindless material table
+const unsigned int MATERIAL_TABLE_BINDING = 3;
+
+// How materials reach their textures
+enum Texture_Residency
+{
+	RESIDENCY_BIND,		// one glBindTexture per slot
+	RESIDENCY_ARRAYS,	// shared texture arrays, layers in the material block
+	RESIDENCY_BINDLESS	// resident handles in a storage buffer, indexed by material id
+};
+
+// std430 entry of the material table, handles of the diffuse, specular and emission maps
+struct MaterialTableEntry
+{
+	GLuint64 handles[ARRAY_SLOT_COUNT];
+	float shininess;
+	float emissionIntensity;
+};
+
+// Textures and surface parameters resolved once when a mesh is imported. Binding a
+// material is a fixed set of texture binds and one uniform buffer bind. With texture
+// arrays most of those binds are shared between materials, with bindless textures the
+// only per-draw input is the material id.
+class Material
+{
+public:
+	// Texture bound to each unit, 0 where the material has none
+	unsigned int textures[MATERIAL_SLOT_COUNT] = {};
+
+	float shininess = 32.0f;
+	float emissionIntensity = 0.0f;
+
+	// Creation order, used in sort keys and as the index into the material table
+	unsigned int id;
+
+	// The first texture of each type fills its slot, later ones are ignored
+	explicit Material(const std::vector<Texture> & textures, float shininess = 32.0f);
+	~Material();
+	Material(const Material &) = delete;
+	auto operator=(const Material &) -> Material & = delete;
+
+	// Write shininess and emission to the material's uniform buffer after changing them
+	auto Update() -> void;
+
+	// Sets "materialIndex" on the program in bindless mode
+	auto Bind(const Shader & shader) const -> void;
+
+	// Point the program's material samplers at the slot units, once after loading it
+	static auto AssignUnits(const Shader & shader) -> void;
+
+	// Shared material for a texture set, created on first use
+	static auto Get(const std::vector<Texture> & textures) -> std::shared_ptr<Material>;
+
+	// Switch every material, existing and future, to a residency mode. Arrays must hold
+	// the textures for RESIDENCY_ARRAYS, materials with unpacked textures keep binding.
+	static auto SetResidency(Texture_Residency residency, const TextureArrays * arrays = nullptr) -> void;
+	static auto Residency() -> Texture_Residency;
+
+	// Every texture used by a live material
+	static auto AllTextures() -> std::vector<unsigned int>;
+
+private:
+	UniformBuffer<MaterialUniforms> uniforms_;
+
+	// Array layer, or bindless handle, of the diffuse, specular and emission maps
+	TextureLayer layers_[ARRAY_SLOT_COUNT];
+	GLuint64 handles_[ARRAY_SLOT_COUNT] = {};
+	bool useArrays_ = false;
+
+	static unsigned int nextId_;
+	static std::vector<std::shared_ptr<Material>> registry_;
+	static std::vector<Material *> live_;
+
+	static Texture_Residency residency_;
+	static const TextureArrays * arrays_;
+	static unsigned int tableBuffer_;
+	static unsigned int tableEntries_;
+
+	auto Resolve() -> void;
+	static auto UploadTable() -> void;
+};
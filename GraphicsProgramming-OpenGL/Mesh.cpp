@@ -2,102 +2,206 @@
 #include <glad/glad.h>
 #include "Shader.h"
 #include <iostream>
+#include <glm/glm.hpp>
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "MeshPool.h"
 
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<Texture> textures, const VertexLayout& layout) :
+	Mesh(std::move(vertices), std::move(indices), Material::Get(textures), layout)
+{
+}
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::vector<Texture> textures): 
-	vertices_(std::move(vertices)), indices_(std::move(indices)), textures_(std::move(textures))
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, std::shared_ptr<Material> material, const VertexLayout& layout) :
+	vertices_(std::move(vertices)), indices_(std::move(indices)), material_(std::move(material))
 {
-	SetupMesh();
+	ComputeBounds();
+	meshlets_ = BuildMeshlets(vertices_, indices_);
+	MeshPool::Shared(layout).Add(*this);
 }
 
-auto Mesh::SetupMesh() -> void
+auto Mesh::ComputeBounds() -> void
 {
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+	boundsMin_ = glm::vec3(0);
+	boundsMax_ = glm::vec3(0);
+	if (vertices_.empty()) return;
 
-	// Buffer vertex data to the GPU -----------------------------------------------------------------
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	boundsMin_ = vertices_[0].Position;
+	boundsMax_ = vertices_[0].Position;
+	for (auto& vertex : vertices_)
+	{
+		boundsMin_ = glm::min(boundsMin_, vertex.Position);
+		boundsMax_ = glm::max(boundsMax_, vertex.Position);
+	}
+}
 
-	glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), &vertices_[0], GL_STATIC_DRAW);
-	
-	// Buffer edge list data to the GPU --------------------------------------------------------------
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int), &indices_[0], GL_STATIC_DRAW);
+auto Mesh::Draw(Shader shaderProgram) -> void
+{
+	if (!Drawable()) return;
 
-	// Setup the VAO attributes ----------------------------------------------------------------------
-	// Vertex Positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<void *>(nullptr));
+	material_->Bind(shaderProgram);
+	ApplyFaceCulling();
 
-	// Vertex Normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, Normal)));
+	// Draw Mesh -------------------------------------------------------------------------------------
+	pool_->Bind(IndexType());
+	pool_->SetDecoding(shaderProgram);
+	glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indices_.size()), IndexType(),
+		reinterpret_cast<void *>(static_cast<size_t>(FirstIndex()) * IndexSize()), BaseVertex());
+}
 
-	// Vertex Texture Coordinates
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, TexCoords)));
+auto Mesh::Draw(Shader shaderProgram, const glm::mat4& modelMatrix) -> void
+{
+	if (auto queue = RenderQueue::Recording())
+	{
+		queue->Submit(shaderProgram, *this, modelMatrix);
+		return;
+	}
 
-	// Vertex Tangent
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, Tangent)));
+	shaderProgram.SetMat4("model", modelMatrix * positionTransform_);
+	Draw(shaderProgram);
+}
 
-	// Vertex Tangent
-	glEnableVertexAttribArray(4);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, Bitangent)));
+// Draw only the meshlets that are inside the frustum and not entirely backfacing.
+// Without updateCulling the ranges that survived the previous call are drawn again.
+auto Mesh::Draw(Shader shaderProgram, FrustumG& frustum, const glm::mat4& modelMatrix, const glm::vec3& viewPosition, const bool updateCulling) -> void
+{
+	if (updateCulling)
+	{
+		CullMeshlets(frustum, modelMatrix, viewPosition);
+	}
 
-	glBindVertexArray(0);
+	DrawRanges(shaderProgram, modelMatrix, drawCounts_, drawOffsets_);
 }
 
-auto Mesh::Draw(Shader shaderProgram) -> void
+auto Mesh::DrawInstanced(Shader shaderProgram, const std::vector<glm::mat4>& transforms, const std::vector<glm::vec4>& params) -> void
 {
-	if (textures_.size() > 0)
+	if (transforms.empty() || !Drawable()) return;
+
+	instances_.resize(transforms.size());
+	for (unsigned int i = 0; i < transforms.size(); ++i)
 	{
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
+		instances_[i].Transform = transforms[i] * positionTransform_;
+		instances_[i].Params = i < params.size() ? params[i] : glm::vec4(1.0f);
+		instances_[i].MaterialIndex = static_cast<int>(material_->id);
+	}
 
+	if (!pool_->UploadInstances(instances_)) return;
 
-		for (unsigned int i = 0; i < textures_.size(); ++i)
-		{
-			glActiveTexture(GL_TEXTURE0 + i);
-
-			std::string textureNumber;
-			const auto textureType = textures_.at(i).type;
-
-			// Increment the counters based on the texture type
-			if (textureType == "texture_diffuse")
-			{
-				textureNumber = std::to_string(diffuseNr++);
-			}
-			else if (textureType == "texture_specular")
-			{
-				textureNumber = std::to_string(specularNr++);
-			}
-			else if (textureType == "texture_normal")
-			{
-				textureNumber = std::to_string(normalNr++);
-			}
-			else if (textureType == "texture_height")
-			{
-				textureNumber = std::to_string(heightNr++);
-			}
-
-			shaderProgram.SetFloat(("material." + textureType + textureNumber).c_str(), i);
-
-			glBindTexture(GL_TEXTURE_2D, textures_[i].id);
-		}
+	material_->Bind(shaderProgram);
+	ApplyFaceCulling();
 
-		// Set the active texture to the first one
-		glActiveTexture(GL_TEXTURE0);
+	// Draw Instances --------------------------------------------------------------------------------
+	shaderProgram.SetBool("instanced", true);
+	pool_->Bind(IndexType());
+	pool_->SetDecoding(shaderProgram);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(indices_.size()), IndexType(),
+		reinterpret_cast<void *>(static_cast<size_t>(FirstIndex()) * IndexSize()), static_cast<GLsizei>(instances_.size()), BaseVertex());
+	shaderProgram.SetBool("instanced", false);
+}
+
+// Draw several index ranges with one multi draw, offsets are rescaled to the pool's index width
+auto Mesh::DrawRanges(Shader shaderProgram, const glm::mat4& modelMatrix, const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets) -> void
+{
+	if (counts.empty()) return;
+
+	if (auto queue = RenderQueue::Recording())
+	{
+		queue->Submit(shaderProgram, *this, modelMatrix, counts, offsets);
+		return;
 	}
 
+	if (!Drawable()) return;
 
-	// Draw Mesh -------------------------------------------------------------------------------------
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	shaderProgram.SetMat4("model", modelMatrix * positionTransform_);
+	material_->Bind(shaderProgram);
+	ApplyFaceCulling();
+
+	// Draw ranges -----------------------------------------------------------------------------------
+	const auto indexSize = IndexSize();
+	const auto firstByte = static_cast<size_t>(FirstIndex()) * indexSize;
+	poolOffsets_.resize(offsets.size());
+	for (unsigned int i = 0; i < offsets.size(); ++i)
+	{
+		poolOffsets_[i] = reinterpret_cast<const void *>(firstByte + reinterpret_cast<size_t>(offsets[i]) / sizeof(unsigned int) * indexSize);
+	}
+	poolBaseVertices_.assign(counts.size(), BaseVertex());
+
+	pool_->Bind(IndexType());
+	pool_->SetDecoding(shaderProgram);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), IndexType(), poolOffsets_.data(), static_cast<GLsizei>(counts.size()), poolBaseVertices_.data());
+}
+
+auto Mesh::Drawable() const -> bool
+{
+	if (pool_ != nullptr && material_ != nullptr) return true;
 
+	std::cout << "ERROR::MESH::NOT_DRAWABLE " << (pool_ == nullptr ? "mesh is not in a MeshPool" : "mesh has no material") << std::endl;
+	return false;
+}
+
+auto Mesh::BaseVertex() const -> int
+{
+	return pool_ != nullptr ? pool_->BaseVertex(*this) : 0;
+}
+
+auto Mesh::FirstIndex() const -> unsigned int
+{
+	return pool_ != nullptr ? pool_->FirstIndex(*this) : 0;
+}
+
+auto Mesh::IndexType() const -> GLenum
+{
+	return vertices_.size() <= MESH_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+auto Mesh::IndexSize() const -> unsigned int
+{
+	return IndexType() == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+auto Mesh::Layout() const -> VertexLayout
+{
+	return pool_ != nullptr ? pool_->Layout() : VertexLayout::Standard();
+}
+
+auto Mesh::ResetCulling() -> void
+{
+	drawCounts_.clear();
+	drawOffsets_.clear();
+}
+
+auto Mesh::ApplyFaceCulling() const -> void
+{
+	if (doubleSided_) GLState::Disable(GL_CULL_FACE);
+	else GLState::Enable(GL_CULL_FACE);
+}
+
+auto Mesh::CullMeshlets(FrustumG& frustum, const glm::mat4& modelMatrix, const glm::vec3& viewPosition) -> void
+{
+	// Backface tests happen in object space, frustum tests in world space
+	const auto objectViewPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(viewPosition, 1.0f));
+	const auto maxScale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+		glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+	drawCounts_.clear();
+	drawOffsets_.clear();
+
+	for (auto& meshlet : meshlets_)
+	{
+		if (!doubleSided_ && MeshletBackfacing(meshlet, objectViewPosition)) continue;
+
+		auto center = glm::vec3(modelMatrix * glm::vec4(meshlet.center, 1.0f));
+		if (frustum.sphereInFrustum(center, meshlet.radius * maxScale) == FrustumG::OUTSIDE) continue;
+
+		// Merge with the previous range when the meshlets are adjacent in the index buffer
+		const auto offset = reinterpret_cast<const void *>(meshlet.firstIndex * sizeof(unsigned int));
+		if (!drawCounts_.empty() && static_cast<const char *>(drawOffsets_.back()) + drawCounts_.back() * sizeof(unsigned int) == offset)
+		{
+			drawCounts_.back() += meshlet.indexCount;
+			continue;
+		}
+
+		drawCounts_.push_back(meshlet.indexCount);
+		drawOffsets_.push_back(offset);
+	}
 }
\ No newline at end of file
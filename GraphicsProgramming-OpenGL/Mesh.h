@@ -1,8 +1,29 @@
 #pragma once
 #include "Vertex.h"
 #include <vector>
+#include <memory>
 #include "Texture.h"
+#include "Material.h"
 #include "Shader.h"
+#include "Meshlet.h"
+#include "FrustumG.h"
+#include "VertexLayout.h"
+
+class MeshPool;
+struct MeshPoolRanges;
+
+// Meshes with at most this many vertices are drawn with 16 bit indices
+const unsigned int MESH_SHORT_INDEX_VERTICES = 1 << 16;
+
+// Per-instance data for instanced draws (vertex attributes 5-8, 9 and 10)
+struct InstanceData
+{
+	glm::mat4 Transform;
+	glm::vec4 Params;
+	// Material table index, only read by the bindless shaders
+	int MaterialIndex;
+	int Padding[3];
+};
 
 class Mesh
 {
@@ -10,14 +31,78 @@ public:
 	// Mesh Data
 	std::vector<Vertex> vertices_;
 	std::vector<unsigned int> indices_;
-	std::vector<Texture> textures_;
+	std::shared_ptr<Material> material_;
+
+	// Object space axis aligned bounds
+	glm::vec3 boundsMin_;
+	glm::vec3 boundsMax_;
+
+	// Triangle clusters for frustum and backface culling
+	std::vector<Meshlet> meshlets_;
+
+	// Open or single sided geometry (foliage cards, shells without a back), drawn with
+	// GL_CULL_FACE off and without the backfacing meshlet test
+	bool doubleSided_ = false;
+
+	// Pool holding the geometry and the mesh's vertex / index ranges in it. Copies of the
+	// mesh share the ranges, the pool gets them back when the last copy is destroyed.
+	MeshPool * pool_ = nullptr;
+	std::shared_ptr<MeshPoolRanges> poolRanges_;
+	// Maps the positions stored in the pool to object space, folded into every model matrix
+	// the mesh is drawn with
+	glm::mat4 positionTransform_ = glm::mat4(1.0f);
 
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+	// Empty and outside any pool until a mesh is assigned to it
+	Mesh() = default;
+	// The texture set is turned into a shared Material. The geometry is added to the
+	// MeshPool::Shared of the layout.
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, const VertexLayout & layout = VertexLayout::Standard());
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::shared_ptr<Material> material, const VertexLayout & layout = VertexLayout::Standard());
+	// Draws with the "model" uniform as it is, which must include positionTransform_
 	auto Draw(Shader shader) -> void;
 
+	// Sets the "model" uniform, or submits to the recording RenderQueue
+	auto Draw(Shader shader, const glm::mat4 & modelMatrix) -> void;
+	auto Draw(Shader shader, FrustumG & frustum, const glm::mat4 & modelMatrix, const glm::vec3 & viewPosition, bool updateCulling = true) -> void;
+
+	// One draw for many copies, params default to (1, 1, 1, 1) when not given
+	auto DrawInstanced(Shader shader, const std::vector<glm::mat4> & transforms, const std::vector<glm::vec4> & params = {}) -> void;
+
+	// Counts in indices, offsets in bytes into indices_ (32 bit, whatever width the pool holds)
+	auto DrawRanges(Shader shader, const glm::mat4 & modelMatrix, const std::vector<GLsizei> & counts, const std::vector<const void *> & offsets) -> void;
+
+	// Forget the surviving meshlets, e.g. when the mesh was culled as a whole
+	auto ResetCulling() -> void;
+
+	// Turn GL_CULL_FACE off for double sided meshes and on for everything else
+	auto ApplyFaceCulling() const -> void;
+
+	// False, with an error printed, for meshes outside any pool (removed from it, or
+	// default constructed) or without a material. Nothing is drawn for them.
+	auto Drawable() const -> bool;
+
+	// The mesh's offsets in the pool buffers
+	auto BaseVertex() const -> int;
+	auto FirstIndex() const -> unsigned int;
+	// GL_UNSIGNED_SHORT when the vertex count allows it, the pool stores the indices that way
+	auto IndexType() const -> GLenum;
+	auto IndexSize() const -> unsigned int;
+	// Layout of the pool the mesh lives in
+	auto Layout() const -> VertexLayout;
+
 private:
-	unsigned int VAO, VBO, EBO;
+	// Scratch instance data for instanced draws
+	std::vector<InstanceData> instances_;
+
+	// Scratch ranges for multi draws of the surviving meshlets, offsets relative to the mesh
+	std::vector<GLsizei> drawCounts_;
+	std::vector<const void *> drawOffsets_;
+
+	// The same ranges moved to the mesh's place in the pool
+	std::vector<const void *> poolOffsets_;
+	std::vector<GLint> poolBaseVertices_;
 
-	auto SetupMesh() -> void;
+	auto CullMeshlets(FrustumG & frustum, const glm::mat4 & modelMatrix, const glm::vec3 & viewPosition) -> void;
+	auto ComputeBounds() -> void;
 };
 
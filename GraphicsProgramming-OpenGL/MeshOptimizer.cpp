@@ -0,0 +1,312 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace
+{
+	struct VertexHash
+	{
+		auto operator()(const Vertex& vertex) const -> size_t
+		{
+			const float values[] = { vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.Normal.x, vertex.Normal.y, vertex.Normal.z, vertex.TexCoords.x, vertex.TexCoords.y };
+			auto hash = size_t(0);
+			for (auto value : values)
+			{
+				hash = hash * 31 + std::hash<float>()(value);
+			}
+			return hash;
+		}
+	};
+
+	struct VertexEqual
+	{
+		auto operator()(const Vertex& a, const Vertex& b) const -> bool
+		{
+			return a.Position == b.Position && a.Normal == b.Normal && a.TexCoords == b.TexCoords && a.Tangent == b.Tangent && a.Bitangent == b.Bitangent;
+		}
+	};
+
+	// A vertex is in the FIFO while fewer than VERTEX_CACHE_SIZE vertices were added after it
+	struct CacheEmulator
+	{
+		std::vector<unsigned int> stamps;
+		unsigned int time;
+
+		explicit CacheEmulator(const unsigned int vertexCount) :
+			stamps(vertexCount, 0), time(VERTEX_CACHE_SIZE + 1)
+		{
+		}
+
+		auto Flush() -> void
+		{
+			time += VERTEX_CACHE_SIZE + 1;
+		}
+
+		auto Contains(const unsigned int vertex) const -> bool
+		{
+			return time - stamps[vertex] <= VERTEX_CACHE_SIZE;
+		}
+
+		// Misses of one triangle, 0-3
+		auto Add(const unsigned int* triangle) -> unsigned int
+		{
+			auto misses = 0u;
+			for (auto corner = 0; corner < 3; ++corner)
+			{
+				if (Contains(triangle[corner])) continue;
+				stamps[triangle[corner]] = time++;
+				++misses;
+			}
+			return misses;
+		}
+	};
+
+	// Vertex whose fan is continued after a dead end: the most recent one on the stack with
+	// triangles left, or else the next such vertex in index order. -1 when all are emitted.
+	auto SkipDeadEnd(const std::vector<unsigned int>& live, std::vector<unsigned int>& deadEnds, unsigned int& cursor) -> int
+	{
+		while (!deadEnds.empty())
+		{
+			const auto vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex] > 0) return static_cast<int>(vertex);
+		}
+
+		for (; cursor < live.size(); ++cursor)
+		{
+			if (live[cursor] > 0) return static_cast<int>(cursor);
+		}
+		return -1;
+	}
+}
+
+auto WeldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) -> void
+{
+	auto unique = std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual>();
+	unique.reserve(vertices.size());
+
+	auto remap = std::vector<unsigned int>(vertices.size());
+	auto welded = std::vector<Vertex>();
+	welded.reserve(vertices.size());
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		const auto found = unique.emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+		if (found.second) welded.push_back(vertices[i]);
+		remap[i] = found.first->second;
+	}
+
+	for (auto& index : indices)
+	{
+		index = remap[index];
+	}
+	vertices = std::move(welded);
+}
+
+auto OptimizeVertexCache(std::vector<unsigned int>& indices, const unsigned int vertexCount) -> std::vector<unsigned int>
+{
+	const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+	auto clusters = std::vector<unsigned int>();
+	if (triangleCount == 0) return clusters;
+
+	// Triangles around each vertex ------------------------------------------------------------------
+	auto live = std::vector<unsigned int>(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+	{
+		++live[indices[i]];
+	}
+
+	auto firstTriangle = std::vector<unsigned int>(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + live[v];
+	}
+
+	auto adjacency = std::vector<unsigned int>(triangleCount * 3);
+	auto filled = std::vector<unsigned int>(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+	{
+		adjacency[filled[indices[i]]++] = i / 3;
+	}
+
+	// Fan around the vertex that stays in the cache longest ----------------------------------------
+	auto cache = CacheEmulator(vertexCount);
+	auto emitted = std::vector<bool>(triangleCount, false);
+	auto deadEnds = std::vector<unsigned int>();
+	auto candidates = std::vector<unsigned int>();
+	auto output = std::vector<unsigned int>();
+	output.reserve(triangleCount * 3);
+	auto cursor = 0u;
+
+	auto fanning = SkipDeadEnd(live, deadEnds, cursor);
+	clusters.push_back(0);
+	while (fanning >= 0)
+	{
+		candidates.clear();
+		for (auto a = firstTriangle[fanning]; a < firstTriangle[fanning + 1]; ++a)
+		{
+			const auto triangle = adjacency[a];
+			if (emitted[triangle]) continue;
+
+			for (auto corner = 0; corner < 3; ++corner)
+			{
+				const auto vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+			}
+			cache.Add(&indices[triangle * 3]);
+			emitted[triangle] = true;
+		}
+
+		// Prefer vertices whose remaining fan still fits before they leave the cache
+		auto next = -1;
+		auto bestPriority = -1;
+		for (auto vertex : candidates)
+		{
+			if (live[vertex] == 0) continue;
+
+			auto priority = 0;
+			const auto age = static_cast<int>(cache.time - cache.stamps[vertex]);
+			if (age + 2 * static_cast<int>(live[vertex]) <= static_cast<int>(VERTEX_CACHE_SIZE)) priority = age;
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = static_cast<int>(vertex);
+			}
+		}
+
+		if (next < 0)
+		{
+			next = SkipDeadEnd(live, deadEnds, cursor);
+			if (next >= 0) clusters.push_back(static_cast<unsigned int>(output.size() / 3));
+		}
+		fanning = next;
+	}
+
+	indices = std::move(output);
+	return clusters;
+}
+
+auto OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters) -> void
+{
+	const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+	if (clusters.empty() || triangleCount == 0) return;
+
+	// Soft boundaries: restart a cluster once it has reached the cache efficiency of its whole
+	// hard cluster, where a flush from reordering costs little --------------------------------
+	auto cache = CacheEmulator(static_cast<unsigned int>(vertices.size()));
+	auto boundaries = std::vector<unsigned int>();
+	for (unsigned int c = 0; c < clusters.size(); ++c)
+	{
+		const auto begin = clusters[c];
+		const auto end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		cache.Flush();
+		auto clusterMisses = 0u;
+		for (auto t = begin; t < end; ++t)
+		{
+			clusterMisses += cache.Add(&indices[t * 3]);
+		}
+		const auto threshold = OVERDRAW_SPLIT_THRESHOLD * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+		boundaries.push_back(begin);
+		cache.Flush();
+		auto misses = 0u;
+		auto triangles = 0u;
+		for (auto t = begin; t + 1 < end; ++t)
+		{
+			misses += cache.Add(&indices[t * 3]);
+			++triangles;
+			if (triangles >= OVERDRAW_MIN_CLUSTER_TRIANGLES && static_cast<float>(misses) <= threshold * static_cast<float>(triangles))
+			{
+				boundaries.push_back(t + 1);
+				cache.Flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+	}
+	boundaries.push_back(triangleCount);
+
+	// Area weighted centre and normal of every cluster and of the mesh ------------------------------
+	const auto clusterCount = static_cast<unsigned int>(boundaries.size() - 1);
+	auto centers = std::vector<glm::vec3>(clusterCount, glm::vec3(0));
+	auto normals = std::vector<glm::vec3>(clusterCount, glm::vec3(0));
+	auto meshCenter = glm::vec3(0);
+	auto meshArea = 0.0f;
+	for (unsigned int c = 0; c < clusterCount; ++c)
+	{
+		auto area = 0.0f;
+		for (auto t = boundaries[c]; t < boundaries[c + 1]; ++t)
+		{
+			const auto& a = vertices[indices[t * 3]].Position;
+			const auto& b = vertices[indices[t * 3 + 1]].Position;
+			const auto& d = vertices[indices[t * 3 + 2]].Position;
+			const auto normal = glm::cross(b - a, d - a);
+			const auto triangleArea = glm::length(normal);
+
+			centers[c] += (a + b + d) / 3.0f * triangleArea;
+			normals[c] += normal;
+			area += triangleArea;
+		}
+
+		meshCenter += centers[c];
+		meshArea += area;
+		if (area > 0.0f) centers[c] /= area;
+	}
+	if (meshArea > 0.0f) meshCenter /= meshArea;
+
+	// Clusters facing away from the centre occlude the others, draw them first ---------------------
+	auto facing = std::vector<float>(clusterCount, 0.0f);
+	auto order = std::vector<unsigned int>(clusterCount);
+	for (unsigned int c = 0; c < clusterCount; ++c)
+	{
+		order[c] = c;
+		if (glm::length(normals[c]) > 0.0f) facing[c] = glm::dot(centers[c] - meshCenter, glm::normalize(normals[c]));
+	}
+	std::stable_sort(order.begin(), order.end(), [&facing](const unsigned int a, const unsigned int b)
+	{
+		return facing[a] > facing[b];
+	});
+
+	auto sorted = std::vector<unsigned int>();
+	sorted.reserve(indices.size());
+	for (auto c : order)
+	{
+		sorted.insert(sorted.end(), indices.begin() + boundaries[c] * 3, indices.begin() + boundaries[c + 1] * 3);
+	}
+	indices = std::move(sorted);
+}
+
+auto OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) -> void
+{
+	auto remap = std::vector<unsigned int>(vertices.size(), ~0u);
+	auto ordered = std::vector<Vertex>();
+	ordered.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = static_cast<unsigned int>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(ordered);
+}
+
+auto OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) -> void
+{
+	WeldVertices(vertices, indices);
+
+	// Only pure triangle lists are reordered
+	if (indices.size() < 3 || indices.size() % 3 != 0) return;
+
+	const auto clusters = OptimizeVertexCache(indices, static_cast<unsigned int>(vertices.size()));
+	OptimizeOverdraw(vertices, indices, clusters);
+	OptimizeVertexFetch(vertices, indices);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// FIFO size the triangle order is tuned for, about what current GPUs reuse
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// Clusters whose running ACMR gets within this factor of the cluster's own are split off
+// for the overdraw sort
+const float OVERDRAW_SPLIT_THRESHOLD = 1.05f;
+const unsigned int OVERDRAW_MIN_CLUSTER_TRIANGLES = 16;
+
+// Import-time optimisation of a triangle list, see OptimizeMesh
+auto WeldVertices(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) -> void;
+// Tipsify (Sander, Nehab & Barczak). Returns the first triangle of every cluster, clusters
+// start where the fan runs into a dead end.
+auto OptimizeVertexCache(std::vector<unsigned int> & indices, unsigned int vertexCount) -> std::vector<unsigned int>;
+// Split the clusters further where the cache was flushed anyway and sort them so outward
+// facing clusters come first
+auto OptimizeOverdraw(const std::vector<Vertex> & vertices, std::vector<unsigned int> & indices, const std::vector<unsigned int> & clusters) -> void;
+// Renumber vertices in the order the triangles first use them, dropping unused ones
+auto OptimizeVertexFetch(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) -> void;
+
+// All of the above in order: weld identical vertices, reorder triangles for the post-transform
+// cache and then for overdraw, and reorder vertices for fetch locality
+auto OptimizeMesh(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) -> void;
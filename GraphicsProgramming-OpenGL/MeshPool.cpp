@@ -0,0 +1,254 @@
+#include "MeshPool.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include "GLState.h"
+
+MeshPoolRanges::~MeshPoolRanges()
+{
+	pool->Free(*this);
+}
+
+MeshPool::MeshPool(const VertexLayout& layout) :
+	layout_(layout),
+	format_(layout.Stride(), sizeof(InstanceData), layout.Attributes()),
+	positionFormat_(layout.PositionStride(), sizeof(InstanceData), layout.PositionAttributes()),
+	vertices_(layout.Stride(), MESH_POOL_VERTICES), indices_(sizeof(unsigned int), MESH_POOL_INDICES),
+	shortIndices_(sizeof(unsigned short), MESH_POOL_INDICES)
+{
+	positionStream_ = vertices_.AddStream(layout.PositionStride());
+}
+
+auto MeshPool::Pools() -> std::map<unsigned int, std::unique_ptr<MeshPool>> &
+{
+	static std::map<unsigned int, std::unique_ptr<MeshPool>> pools;
+	return pools;
+}
+
+auto MeshPool::Shared(const VertexLayout& layout) -> MeshPool &
+{
+	auto& pool = Pools()[layout.Key()];
+	if (!pool) pool.reset(new MeshPool(layout));
+	return *pool;
+}
+
+auto MeshPool::All() -> std::vector<MeshPool *>
+{
+	auto pools = std::vector<MeshPool *>();
+	for (auto& entry : Pools())
+	{
+		pools.push_back(entry.second.get());
+	}
+	return pools;
+}
+
+auto MeshPool::Add(Mesh& mesh) -> void
+{
+	if (mesh.pool_ == this) return;
+	if (mesh.pool_ != nullptr) mesh.pool_->Remove(mesh);
+
+	const auto attached = Attached();
+	const auto indexType = mesh.IndexType();
+	auto& indices = Indices(indexType);
+	auto grown = false;
+	const auto vertexRange = Allocate(vertices_, static_cast<unsigned int>(mesh.vertices_.size()), grown);
+	const auto indexRange = Allocate(indices, static_cast<unsigned int>(mesh.indices_.size()), grown);
+	mesh.poolRanges_ = std::shared_ptr<MeshPoolRanges>(new MeshPoolRanges{ this, vertexRange, indexRange, indexType });
+	mesh.pool_ = this;
+
+	if (grown) Release(attached);
+
+	layout_.Pack(mesh.vertices_, mesh.boundsMin_, mesh.boundsMax_, packed_);
+	layout_.PackPositions(mesh.vertices_, mesh.boundsMin_, mesh.boundsMax_, packedPositions_);
+	mesh.positionTransform_ = layout_.PositionTransform(mesh.boundsMin_, mesh.boundsMax_);
+
+	vertices_.Upload(vertexRange, packed_.data(), static_cast<unsigned int>(mesh.vertices_.size()));
+	vertices_.Upload(vertexRange, packedPositions_.data(), static_cast<unsigned int>(mesh.vertices_.size()), positionStream_);
+	if (indexType == GL_UNSIGNED_INT)
+	{
+		indices.Upload(indexRange, mesh.indices_.data(), static_cast<unsigned int>(mesh.indices_.size()));
+		return;
+	}
+
+	packedIndices_.assign(mesh.indices_.begin(), mesh.indices_.end());
+	indices.Upload(indexRange, packedIndices_.data(), static_cast<unsigned int>(packedIndices_.size()));
+}
+
+auto MeshPool::Add(Model& model) -> void
+{
+	for (auto& mesh : model.meshes)
+	{
+		Add(mesh);
+	}
+
+	for (auto& lod : model.lods)
+	{
+		for (auto& mesh : lod.meshes)
+		{
+			Add(mesh);
+		}
+	}
+}
+
+auto MeshPool::Remove(Mesh& mesh) -> void
+{
+	if (mesh.pool_ != this) return;
+
+	mesh.poolRanges_.reset();
+	mesh.pool_ = nullptr;
+}
+
+auto MeshPool::Free(const MeshPoolRanges& ranges) -> void
+{
+	vertices_.Free(ranges.vertices);
+	Indices(ranges.indexType).Free(ranges.indices);
+}
+
+auto MeshPool::Defragment() -> void
+{
+	Release(Attached());
+	vertices_.Defragment();
+	indices_.Defragment();
+	shortIndices_.Defragment();
+}
+
+auto MeshPool::BaseVertex(const Mesh& mesh) const -> int
+{
+	return static_cast<int>(vertices_.Offset(mesh.poolRanges_->vertices));
+}
+
+auto MeshPool::FirstIndex(const Mesh& mesh) const -> unsigned int
+{
+	return Indices(mesh.poolRanges_->indexType).Offset(mesh.poolRanges_->indices);
+}
+
+auto MeshPool::Indices(const GLenum indexType) -> BufferHeap &
+{
+	return indexType == GL_UNSIGNED_SHORT ? shortIndices_ : indices_;
+}
+
+auto MeshPool::Indices(const GLenum indexType) const -> const BufferHeap &
+{
+	return indexType == GL_UNSIGNED_SHORT ? shortIndices_ : indices_;
+}
+
+// Both formats with both index heaps
+auto MeshPool::Attached() const -> std::vector<VertexBuffers>
+{
+	return { Buffers(GL_UNSIGNED_INT), Buffers(GL_UNSIGNED_SHORT), PositionBuffers(GL_UNSIGNED_INT), PositionBuffers(GL_UNSIGNED_SHORT) };
+}
+
+auto MeshPool::Release(const std::vector<VertexBuffers>& attached) -> void
+{
+	format_.Release(attached[0]);
+	format_.Release(attached[1]);
+	positionFormat_.Release(attached[2]);
+	positionFormat_.Release(attached[3]);
+}
+
+// Doubles the heap until the range fits
+auto MeshPool::Allocate(BufferHeap& heap, const unsigned int count, bool& grown) -> unsigned int
+{
+	auto allocation = heap.Allocate(count);
+	while (allocation == BUFFER_HEAP_INVALID && count > 0)
+	{
+		heap.Grow(std::max(heap.Stats().capacity * 2, heap.Stats().capacity + count));
+		allocation = heap.Allocate(count);
+		grown = true;
+	}
+	return allocation;
+}
+
+auto MeshPool::Bind(const GLenum indexType) -> void
+{
+	format_.Bind(Buffers(indexType));
+}
+
+auto MeshPool::BindPositions(const GLenum indexType) -> void
+{
+	positionFormat_.Bind(PositionBuffers(indexType));
+}
+
+auto MeshPool::SetDecoding(Shader shaderProgram) const -> void
+{
+	shaderProgram.SetBool("octahedralNormals", layout_.normals == NORMAL_OCTAHEDRAL);
+}
+
+auto MeshPool::Layout() const -> const VertexLayout &
+{
+	return layout_;
+}
+
+auto MeshPool::Buffers(const GLenum indexType) const -> VertexBuffers
+{
+	return VertexBuffers{ vertices_.Buffer(), StreamBuffer::Shared().Buffer(), Indices(indexType).Buffer(), instanceOffset_ };
+}
+
+auto MeshPool::PositionBuffers(const GLenum indexType) const -> VertexBuffers
+{
+	return VertexBuffers{ vertices_.Buffer(positionStream_), StreamBuffer::Shared().Buffer(), Indices(indexType).Buffer(), instanceOffset_ };
+}
+
+auto MeshPool::Stats() const -> MeshPoolStats
+{
+	const auto vertices = vertices_.Stats();
+	return MeshPoolStats{ vertices, indices_.Stats(), shortIndices_.Stats(), static_cast<unsigned long long>(vertices.used) * (layout_.Stride() + layout_.PositionStride()) };
+}
+
+auto MeshPool::UploadInstances(const std::vector<InstanceData>& instances) -> bool
+{
+	const auto allocation = StreamBuffer::Shared().Write(instances.data(), instances.size() * sizeof(InstanceData), sizeof(InstanceData));
+	if (!allocation.Valid()) return false;
+
+	instanceOffset_ = allocation.offset;
+	return true;
+}
+
+auto MeshPool::Draw(Shader shaderProgram, const std::vector<DrawElementsIndirectCommand>& commands, const std::vector<InstanceData>& instances, const GLenum indexType, const bool positionsOnly) -> unsigned int
+{
+	if (commands.empty()) return 0;
+
+	if (GLExtensions::multiDrawIndirect)
+	{
+		// Per-draw data and the commands both come from this frame's stream partition
+		auto& stream = StreamBuffer::Shared();
+		if (!UploadInstances(instances)) return 0;
+		const auto indirect = stream.Write(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+		if (!indirect.Valid()) return 0;
+
+		if (positionsOnly) BindPositions(indexType);
+		else Bind(indexType);
+		SetDecoding(shaderProgram);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.Buffer());
+
+		shaderProgram.SetBool("instanced", true);
+		GLExtensions::MultiDrawElementsIndirect(GL_TRIANGLES, indexType, reinterpret_cast<const void *>(indirect.offset), static_cast<GLsizei>(commands.size()), 0);
+		shaderProgram.SetBool("instanced", false);
+		return 1;
+	}
+
+	// GL 3.3 has no base instance, so the transform goes through the uniform instead
+	SetDecoding(shaderProgram);
+	const auto indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	const auto modelUniform = shaderProgram.Uniform("model");
+	auto calls = 0u;
+	for (unsigned int first = 0; first < commands.size();)
+	{
+		const auto instance = commands[first].baseInstance;
+		shaderProgram.Set(modelUniform, instances[instance].Transform);
+
+		drawCounts_.clear();
+		drawOffsets_.clear();
+		drawBaseVertices_.clear();
+		for (; first < commands.size() && commands[first].baseInstance == instance; ++first)
+		{
+			drawCounts_.push_back(static_cast<GLsizei>(commands[first].count));
+			drawOffsets_.push_back(reinterpret_cast<const void *>(static_cast<size_t>(commands[first].firstIndex) * indexSize));
+			drawBaseVertices_.push_back(commands[first].baseVertex);
+		}
+
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts_.data(), indexType, drawOffsets_.data(),
+			static_cast<GLsizei>(drawCounts_.size()), drawBaseVertices_.data());
+		++calls;
+	}
+	return calls;
+}
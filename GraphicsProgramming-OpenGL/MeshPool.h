@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <memory>
+#include "Mesh.h"
+#include "Model.h"
+#include "GLExtensions.h"
+#include "BufferHeap.h"
+#include "VertexFormat.h"
+#include "VertexLayout.h"
+#include "StreamBuffer.h"
+
+// Initial heap sizes in vertices and indices, a heap doubles whenever it is full
+const unsigned int MESH_POOL_VERTICES = 1 << 16;
+const unsigned int MESH_POOL_INDICES = 1 << 18;
+
+struct MeshPoolStats
+{
+	BufferHeapStats vertices;
+	BufferHeapStats indices;
+	BufferHeapStats shortIndices;
+	// Bytes of vertex data in use, both streams
+	unsigned long long vertexBytes;
+};
+
+// A mesh's vertex range and index range in a pool, owned by every copy of the mesh
+struct MeshPoolRanges
+{
+	MeshPool * pool;
+	unsigned int vertices;
+	unsigned int indices;
+	GLenum indexType;
+
+	// Gives both ranges back to the pool's heaps
+	~MeshPoolRanges();
+};
+
+// Mesh geometry in one VertexLayout, sub-allocated from one vertex heap and an index heap per
+// index width and drawn through the VAO of the layout's VertexFormat. The vertex heap has a second stream
+// holding only the positions, which depth only passes draw from with the same indices. Each
+// mesh holds its two ranges, whose offsets serve as baseVertex / firstIndex, so draws of many
+// meshes can be issued as one glMultiDrawElementsIndirect. Per-draw transforms come from the
+// instance attributes (5-10), selected by each command's baseInstance.
+// Every Mesh allocates from the Shared pool of its layout when it is created. Copies of a
+// mesh share its ranges, which stay allocated until the last copy is destroyed.
+class MeshPool
+{
+public:
+	explicit MeshPool(const VertexLayout & layout = VertexLayout::Standard());
+	MeshPool(const MeshPool &) = delete;
+	auto operator=(const MeshPool &) -> MeshPool & = delete;
+
+	// Copy a mesh's geometry into new ranges in the heaps, taking it out of its previous pool.
+	// Other copies keep the ranges they share.
+	auto Add(Mesh & mesh) -> void;
+	// Every mesh of every level of detail
+	auto Add(Model & model) -> void;
+
+	// Take the mesh out of the pool, its ranges go back to the heaps once no copy uses them
+	auto Remove(Mesh & mesh) -> void;
+
+	// Close the gaps left by destroyed and removed meshes. Moves the ranges, meshes pick up
+	// the new offsets on their next draw.
+	auto Defragment() -> void;
+
+	auto BaseVertex(const Mesh & mesh) const -> int;
+	auto FirstIndex(const Mesh & mesh) const -> unsigned int;
+
+	// Bind the format's VAO with the pool's buffers and the index heap of that width attached
+	auto Bind(GLenum indexType = GL_UNSIGNED_INT) -> void;
+	auto BindPositions(GLenum indexType = GL_UNSIGNED_INT) -> void;
+	// Tell the shader how the pool's normals are stored, "octahedralNormals"
+	auto SetDecoding(Shader shaderProgram) const -> void;
+	auto Layout() const -> const VertexLayout &;
+	auto Buffers(GLenum indexType = GL_UNSIGNED_INT) const -> VertexBuffers;
+	auto PositionBuffers(GLenum indexType = GL_UNSIGNED_INT) const -> VertexBuffers;
+	auto Stats() const -> MeshPoolStats;
+
+	// Write the per-instance data behind attributes 5-10 into the StreamBuffer, picked up
+	// by the next Bind. False when the stream is full this frame.
+	auto UploadInstances(const std::vector<InstanceData> & instances) -> bool;
+
+	// Draw commands against the pool with its vertex array bound, all of them into the index
+	// heap of indexType. Commands index into instances through baseInstance. Without multi
+	// draw indirect each run of commands with the same instance becomes a
+	// glMultiDrawElementsBaseVertex with the "model" uniform set. Depth only draws read the
+	// position stream. Returns the number of GL draw calls issued.
+	auto Draw(Shader shaderProgram, const std::vector<DrawElementsIndirectCommand> & commands, const std::vector<InstanceData> & instances, GLenum indexType, bool positionsOnly = false) -> unsigned int;
+
+	// One pool per layout, created on first use
+	static auto Shared(const VertexLayout & layout = VertexLayout::Standard()) -> MeshPool &;
+	static auto All() -> std::vector<MeshPool *>;
+
+private:
+	friend struct MeshPoolRanges;
+
+	VertexLayout layout_;
+	VertexFormat format_;
+	VertexFormat positionFormat_;
+
+	BufferHeap vertices_;
+	BufferHeap indices_;
+	BufferHeap shortIndices_;
+	unsigned int positionStream_;
+
+	// Where the last uploaded instances start in the stream
+	GLintptr instanceOffset_ = 0;
+
+	// Encoded vertices and positions of the mesh being added
+	std::vector<unsigned char> packed_;
+	std::vector<unsigned char> packedPositions_;
+	std::vector<unsigned short> packedIndices_;
+
+	// Scratch ranges for the fallback multi draws
+	std::vector<GLsizei> drawCounts_;
+	std::vector<const void *> drawOffsets_;
+	std::vector<GLint> drawBaseVertices_;
+
+	auto Free(const MeshPoolRanges & ranges) -> void;
+	auto Indices(GLenum indexType) -> BufferHeap &;
+	auto Indices(GLenum indexType) const -> const BufferHeap &;
+	// Every set of buffers the formats may have attached, to release before they move
+	auto Attached() const -> std::vector<VertexBuffers>;
+	auto Release(const std::vector<VertexBuffers> & attached) -> void;
+
+	static auto Pools() -> std::map<unsigned int, std::unique_ptr<MeshPool>> &;
+	static auto Allocate(BufferHeap & heap, unsigned int count, bool & grown) -> unsigned int;
+};
@@ -0,0 +1,71 @@
+#include "MeshSimplifier.h"
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+auto SimplifyMesh(const Mesh& mesh, float cellSize) -> Mesh
+{
+	auto vertices = std::vector<Vertex>();
+	auto indices = std::vector<unsigned int>();
+
+	if (mesh.vertices_.empty() || cellSize <= 0.0f)
+	{
+		return Mesh(mesh.vertices_, mesh.indices_, mesh.material_, mesh.Layout());
+	}
+
+	// Assign every vertex to a grid cell ------------------------------------------------------------
+	const auto cells = glm::max(glm::ivec3((mesh.boundsMax_ - mesh.boundsMin_) / cellSize) + 1, glm::ivec3(1));
+	auto cellToVertex = std::unordered_map<long long, unsigned int>();
+	auto remap = std::vector<unsigned int>(mesh.vertices_.size());
+	auto weights = std::vector<float>();
+
+	for (unsigned int i = 0; i < mesh.vertices_.size(); ++i)
+	{
+		const auto& vertex = mesh.vertices_[i];
+		const auto cell = glm::clamp(glm::ivec3((vertex.Position - mesh.boundsMin_) / cellSize), glm::ivec3(0), cells - 1);
+		const auto key = (static_cast<long long>(cell.z) * cells.y + cell.y) * cells.x + cell.x;
+
+		auto found = cellToVertex.find(key);
+		if (found == cellToVertex.end())
+		{
+			found = cellToVertex.emplace(key, static_cast<unsigned int>(vertices.size())).first;
+			vertices.push_back(Vertex());
+			vertices.back().Position = glm::vec3(0);
+			vertices.back().Normal = glm::vec3(0);
+			vertices.back().TexCoords = glm::vec2(0);
+			vertices.back().Tangent = glm::vec3(0);
+			vertices.back().Bitangent = glm::vec3(0);
+			weights.push_back(0.0f);
+		}
+
+		// Accumulate the cell's representative vertex
+		const auto target = found->second;
+		vertices[target].Position += vertex.Position;
+		vertices[target].Normal += vertex.Normal;
+		vertices[target].TexCoords += vertex.TexCoords;
+		weights[target] += 1.0f;
+		remap[i] = target;
+	}
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		vertices[i].Position /= weights[i];
+		vertices[i].TexCoords /= weights[i];
+		if (glm::length(vertices[i].Normal) > 0.0f)
+			vertices[i].Normal = glm::normalize(vertices[i].Normal);
+	}
+
+	// Keep the triangles that still span three cells ------------------------------------------------
+	for (unsigned int i = 0; i + 2 < mesh.indices_.size(); i += 3)
+	{
+		const auto a = remap[mesh.indices_[i]];
+		const auto b = remap[mesh.indices_[i + 1]];
+		const auto c = remap[mesh.indices_[i + 2]];
+		if (a == b || b == c || a == c) continue;
+
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+
+	return Mesh(vertices, indices, mesh.material_, mesh.Layout());
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "Mesh.h"
+
+// Vertex clustering simplification (Rossignac & Borrel). Vertices are snapped to a
+// uniform grid of cellSize, each occupied cell becomes one vertex and triangles that
+// collapse are dropped. The material is shared with the source mesh.
+auto SimplifyMesh(const Mesh & mesh, float cellSize) -> Mesh;
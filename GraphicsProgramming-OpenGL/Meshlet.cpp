@@ -0,0 +1,146 @@
+#include "Meshlet.h"
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Fill in the bounding sphere and normal cone of a finished meshlet
+	auto ComputeMeshletBounds(Meshlet & meshlet, const std::vector<Vertex> & vertices, const std::vector<unsigned int> & indices) -> void
+	{
+		// Bounding sphere around the centre of the cluster's AABB -------------------------------
+		auto min = vertices[indices[meshlet.firstIndex]].Position;
+		auto max = min;
+		for (auto i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+		{
+			min = glm::min(min, vertices[indices[i]].Position);
+			max = glm::max(max, vertices[indices[i]].Position);
+		}
+
+		meshlet.center = (min + max) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (auto i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+		{
+			meshlet.radius = glm::max(meshlet.radius, glm::distance(meshlet.center, vertices[indices[i]].Position));
+		}
+
+		// Normal cone ---------------------------------------------------------------------------
+		// Defaults describe a cone that never culls
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = glm::vec3(0);
+		meshlet.coneCutoff = 1.0f;
+
+		auto normals = std::vector<glm::vec3>();
+		normals.reserve(meshlet.indexCount / 3);
+
+		auto axis = glm::vec3(0);
+		for (auto i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+		{
+			const auto& p0 = vertices[indices[i]].Position;
+			const auto& p1 = vertices[indices[i + 1]].Position;
+			const auto& p2 = vertices[indices[i + 2]].Position;
+
+			const auto normal = glm::cross(p1 - p0, p2 - p0);
+			const auto area = glm::length(normal);
+
+			// Degenerate triangles don't constrain the cone
+			if (area == 0.0f) continue;
+
+			normals.push_back(normal / area);
+			axis += normal / area;
+		}
+
+		if (normals.empty() || glm::length(axis) == 0.0f) return;
+		axis = glm::normalize(axis);
+
+		auto minDot = 1.0f;
+		for (auto& normal : normals)
+		{
+			minDot = glm::min(minDot, glm::dot(axis, normal));
+		}
+
+		// Cone wider than ~90 degrees can't be culled from anywhere useful
+		if (minDot <= 0.1f) return;
+
+		// Move the apex back along the axis until it is behind every triangle plane
+		auto maxT = 0.0f;
+		auto triangle = 0u;
+		for (auto i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+		{
+			const auto& p0 = vertices[indices[i]].Position;
+			const auto& p1 = vertices[indices[i + 1]].Position;
+			const auto& p2 = vertices[indices[i + 2]].Position;
+			if (glm::length(glm::cross(p1 - p0, p2 - p0)) == 0.0f) continue;
+
+			const auto& normal = normals[triangle++];
+			const auto t = glm::dot(meshlet.center - p0, normal) / glm::dot(axis, normal);
+			maxT = glm::max(maxT, t);
+		}
+
+		meshlet.coneApex = meshlet.center - axis * maxT;
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = glm::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+auto BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) -> std::vector<Meshlet>
+{
+	auto meshlets = std::vector<Meshlet>();
+	if (indices.size() < 3) return meshlets;
+
+	// Index of the meshlet that last referenced each vertex
+	auto owner = std::vector<unsigned int>(vertices.size(), ~0u);
+
+	auto meshlet = Meshlet();
+	meshlet.firstIndex = 0;
+	meshlet.indexCount = 0;
+	meshlet.vertexCount = 0;
+
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const auto current = static_cast<unsigned int>(meshlets.size());
+		const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+		auto newVertices = 0u;
+		if (owner[a] != current) ++newVertices;
+		if (owner[b] != current && b != a) ++newVertices;
+		if (owner[c] != current && c != a && c != b) ++newVertices;
+
+		// Start a new meshlet when this triangle would overflow the current one
+		if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES)
+		{
+			ComputeMeshletBounds(meshlet, vertices, indices);
+			meshlets.push_back(meshlet);
+
+			meshlet.firstIndex = i;
+			meshlet.indexCount = 0;
+			meshlet.vertexCount = 0;
+		}
+
+		const auto id = static_cast<unsigned int>(meshlets.size());
+		for (auto vertex : { a, b, c })
+		{
+			if (owner[vertex] != id)
+			{
+				owner[vertex] = id;
+				++meshlet.vertexCount;
+			}
+		}
+		meshlet.indexCount += 3;
+	}
+
+	if (meshlet.indexCount > 0)
+	{
+		ComputeMeshletBounds(meshlet, vertices, indices);
+		meshlets.push_back(meshlet);
+	}
+
+	return meshlets;
+}
+
+auto MeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) -> bool
+{
+	const auto toApex = meshlet.coneApex - cameraPosition;
+	const auto distance = glm::length(toApex);
+	if (distance == 0.0f) return false;
+
+	return glm::dot(toApex / distance, meshlet.coneAxis) >= meshlet.coneCutoff;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <glm/vec3.hpp>
+#include "Vertex.h"
+
+// Meshlet size limits
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of triangles occupying a contiguous range of a mesh's index buffer
+struct Meshlet
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int vertexCount;
+
+	// Object space bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone, the whole cluster is backfacing when
+	// dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+// Greedily split a triangle list into meshlets in index order
+auto BuildMeshlets(const std::vector<Vertex> & vertices, const std::vector<unsigned int> & indices) -> std::vector<Meshlet>;
+
+// True when no triangle of the meshlet can face a camera at cameraPosition (object space)
+auto MeshletBackfacing(const Meshlet & meshlet, const glm::vec3 & cameraPosition) -> bool;
@@ -3,7 +3,21 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <iostream>
+#include <glm/gtc/type_ptr.hpp>
 #include "stb_image.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Bounds.h"
+#include "GLState.h"
+
+namespace
+{
+	// Assimp matrices are row major
+	auto ToMat4(const aiMatrix4x4 & matrix) -> glm::mat4
+	{
+		return glm::transpose(glm::make_mat4(&matrix.a1));
+	}
+}
 
 auto Model::LoadModel(std::string path) -> void
 {
@@ -18,24 +32,101 @@ auto Model::LoadModel(std::string path) -> void
 	}
 
 	directory_ = path.substr(0, path.find_last_of('\\'));
+	materials_.assign(scene->mNumMaterials, nullptr);
 
 	ProcessNode(scene->mRootNode, scene);
+	ComputeBounds();
 }
 
-// Recursive function to process all of the nodes of an assimp scene object
-auto Model::ProcessNode(aiNode* node, const aiScene* scene) -> void
+auto Model::ComputeBounds() -> void
 {
-	// Process all node's meshes
-	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+	if (meshes.empty()) return;
+
+	if (nodes.empty())
+	{
+		boundsMin = meshes[0].boundsMin_;
+		boundsMax = meshes[0].boundsMax_;
+		for (auto& mesh : meshes)
+		{
+			boundsMin = glm::min(boundsMin, mesh.boundsMin_);
+			boundsMax = glm::max(boundsMax, mesh.boundsMax_);
+		}
+		return;
+	}
+
+	// Model space transform of every node, parents always come before their children
+	auto globalTransforms = std::vector<glm::mat4>(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		const auto parent = nodes[i].parent;
+		globalTransforms[i] = parent < 0 ? nodes[i].localTransform : globalTransforms[parent] * nodes[i].localTransform;
+	}
+
+	// Bounds of each node's own meshes
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		auto& node = nodes[i];
+		node.empty = true;
+		for (auto m = node.firstMesh; m < node.firstMesh + node.meshCount; ++m)
+		{
+			glm::vec3 min, max;
+			TransformBounds(globalTransforms[i], meshes[m].boundsMin_, meshes[m].boundsMax_, min, max);
+			node.boundsMin = node.empty ? min : glm::min(node.boundsMin, min);
+			node.boundsMax = node.empty ? max : glm::max(node.boundsMax, max);
+			node.empty = false;
+		}
+	}
+
+	// Merge children into their parents, walking backwards so children are complete first
+	for (auto i = static_cast<int>(nodes.size()) - 1; i > 0; --i)
 	{
-		const auto mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(ProcessMesh(mesh, scene));
+		const auto& child = nodes[i];
+		auto& parent = nodes[child.parent];
+		if (child.empty) continue;
+
+		parent.boundsMin = parent.empty ? child.boundsMin : glm::min(parent.boundsMin, child.boundsMin);
+		parent.boundsMax = parent.empty ? child.boundsMax : glm::max(parent.boundsMax, child.boundsMax);
+		parent.empty = false;
 	}
 
-	// Recurse on all children of node
-	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	boundsMin = nodes[0].boundsMin;
+	boundsMax = nodes[0].boundsMax;
+}
+
+// Flatten the assimp node tree breadth first, keeping each node's transform and mesh range
+auto Model::ProcessNode(aiNode* root, const aiScene* scene) -> void
+{
+	auto queue = std::vector<aiNode *>{ root };
+
+	auto rootNode = ModelNode();
+	rootNode.parent = -1;
+	rootNode.localTransform = ToMat4(root->mTransformation);
+	nodes.push_back(rootNode);
+
+	for (unsigned int i = 0; i < queue.size(); ++i)
 	{
-		ProcessNode(node->mChildren[i], scene);
+		const auto node = queue[i];
+
+		// Process all node's meshes
+		nodes[i].firstMesh = static_cast<unsigned int>(meshes.size());
+		nodes[i].meshCount = node->mNumMeshes;
+		for (unsigned int m = 0; m < node->mNumMeshes; ++m)
+		{
+			const auto mesh = scene->mMeshes[node->mMeshes[m]];
+			meshes.push_back(ProcessMesh(mesh, scene));
+		}
+
+		// Queue the children, they end up next to each other
+		nodes[i].firstChild = static_cast<unsigned int>(nodes.size());
+		nodes[i].childCount = node->mNumChildren;
+		for (unsigned int c = 0; c < node->mNumChildren; ++c)
+		{
+			auto child = ModelNode();
+			child.parent = static_cast<int>(i);
+			child.localTransform = ToMat4(node->mChildren[c]->mTransformation);
+			nodes.push_back(child);
+			queue.push_back(node->mChildren[c]);
+		}
 	}
 }
 
@@ -43,12 +134,10 @@ auto Model::ProcessMesh(aiMesh* mesh, const aiScene* scene) -> Mesh
 {
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
-
 	// Read in vertex position, normal and texture coordinates ---------------------------------------
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
-		Vertex vertex;
+		Vertex vertex = Vertex();
 		glm::vec3 vector;
 
 		// Position
@@ -102,25 +191,50 @@ auto Model::ProcessMesh(aiMesh* mesh, const aiScene* scene) -> Mesh
 		}
 	}
 
-	// Load in diffuse maps and specular maps
-	if (mesh->mMaterialIndex >= 0)
+	// Weld, then order for the vertex cache, overdraw and vertex fetch
+	OptimizeMesh(vertices, indices);
+
+	auto result = Mesh(vertices, indices, LoadMaterial(mesh->mMaterialIndex, scene), layout_);
+
+	// Materials flagged two sided keep their back faces
+	auto twoSided = 0;
+	if (mesh->mMaterialIndex < scene->mNumMaterials
+		&& scene->mMaterials[mesh->mMaterialIndex]->Get(AI_MATKEY_TWOSIDED, twoSided) == AI_SUCCESS)
 	{
-		auto material = scene->mMaterials[mesh->mMaterialIndex];
+		result.doubleSided_ = twoSided != 0;
+	}
+	return result;
+}
 
-		auto diffuseMaps = LoadTextureMaterials(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+// Each aiMaterial becomes one Material shared by all meshes that use it
+auto Model::LoadMaterial(const unsigned int index, const aiScene* scene) -> std::shared_ptr<Material>
+{
+	if (index >= materials_.size()) return Material::Get({});
+	if (materials_[index]) return materials_[index];
 
-		auto specularMaps = LoadTextureMaterials(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+	std::vector<Texture> textures;
 
-		auto normalMaps = LoadTextureMaterials(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+	// Load in diffuse maps and specular maps
+	auto material = scene->mMaterials[index];
 
-		auto heightMaps = LoadTextureMaterials(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-	}
+	auto diffuseMaps = LoadTextureMaterials(material, aiTextureType_DIFFUSE, "texture_diffuse");
+	textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+
+	auto specularMaps = LoadTextureMaterials(material, aiTextureType_SPECULAR, "texture_specular");
+	textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+
+	auto normalMaps = LoadTextureMaterials(material, aiTextureType_HEIGHT, "texture_normal");
+	textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
-	return Mesh(vertices, indices, textures);
+	auto heightMaps = LoadTextureMaterials(material, aiTextureType_AMBIENT, "texture_height");
+	textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+
+	auto shininess = 0.0f;
+	material->Get(AI_MATKEY_SHININESS, shininess);
+
+	materials_[index] = std::make_shared<Material>(textures, shininess > 0.0f ? shininess : 32.0f);
+
+	return materials_[index];
 }
 
 auto Model::LoadTextureMaterials(aiMaterial* material, aiTextureType textureType, std::string typeName) -> std::vector<Texture>
@@ -156,19 +270,202 @@ auto Model::LoadTextureMaterials(aiMaterial* material, aiTextureType textureType
 	return textures;
 }
 
-Model::Model(const char* path)
+Model::Model(const char* path, const VertexLayout& layout) :
+	layout_(layout)
 {
 	LoadModel(path);
 }
 
-auto Model::Draw(Shader shaderProgram) -> void
+auto Model::Draw(Shader shaderProgram, const int lod) -> void
 {
-	for (auto&& mesh : meshes)
+	for (auto&& mesh : LodMeshes(lod))
 	{
 		mesh.Draw(shaderProgram);
 	}
 }
 
+// Draw with the node transforms applied, each mesh sets the "model" uniform itself
+auto Model::Draw(Shader shaderProgram, const glm::mat4& modelMatrix, const int lod) -> void
+{
+	if (nodes.empty())
+	{
+		for (auto&& mesh : LodMeshes(lod))
+		{
+			mesh.Draw(shaderProgram, modelMatrix);
+		}
+		return;
+	}
+
+	auto& lodMeshes = LodMeshes(lod);
+	auto globalTransforms = std::vector<glm::mat4>(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		const auto parent = nodes[i].parent;
+		globalTransforms[i] = (parent < 0 ? modelMatrix : globalTransforms[parent]) * nodes[i].localTransform;
+
+		if (nodes[i].meshCount == 0) continue;
+
+		for (auto m = nodes[i].firstMesh; m < nodes[i].firstMesh + nodes[i].meshCount; ++m)
+		{
+			lodMeshes[m].Draw(shaderProgram, globalTransforms[i]);
+		}
+	}
+}
+
+// Instanced draw of every mesh, each node's transform is applied after the instance transform
+auto Model::DrawInstanced(Shader shaderProgram, const std::vector<glm::mat4>& transforms, const std::vector<glm::vec4>& params, const int lod) -> void
+{
+	auto& lodMeshes = LodMeshes(lod);
+
+	if (nodes.empty())
+	{
+		for (auto&& mesh : lodMeshes)
+		{
+			mesh.DrawInstanced(shaderProgram, transforms, params);
+		}
+		return;
+	}
+
+	auto globalTransforms = std::vector<glm::mat4>(nodes.size());
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		const auto parent = nodes[i].parent;
+		globalTransforms[i] = parent < 0 ? nodes[i].localTransform : globalTransforms[parent] * nodes[i].localTransform;
+
+		if (nodes[i].meshCount == 0) continue;
+
+		instanceTransforms_.resize(transforms.size());
+		for (unsigned int t = 0; t < transforms.size(); ++t)
+		{
+			instanceTransforms_[t] = transforms[t] * globalTransforms[i];
+		}
+
+		for (auto m = nodes[i].firstMesh; m < nodes[i].firstMesh + nodes[i].meshCount; ++m)
+		{
+			lodMeshes[m].DrawInstanced(shaderProgram, instanceTransforms_, params);
+		}
+	}
+}
+
+// Walk the node tree, rejecting whole subtrees outside the frustum. Without updateCulling
+// every mesh draws the ranges that survived the last culling pass.
+auto Model::Draw(Shader shaderProgram, FrustumG& frustum, const glm::mat4& modelMatrix, const glm::vec3& viewPosition, const int lod, const bool updateCulling) -> void
+{
+	auto& lodMeshes = LodMeshes(lod);
+
+	if (nodes.empty())
+	{
+		for (auto&& mesh : lodMeshes)
+		{
+			mesh.Draw(shaderProgram, frustum, modelMatrix, viewPosition, updateCulling);
+		}
+		return;
+	}
+
+	if (updateCulling)
+	{
+		// Meshes in rejected subtrees are never visited, so clear everything first
+		for (auto& mesh : lodMeshes)
+		{
+			mesh.ResetCulling();
+		}
+	}
+
+	DrawNode(0, shaderProgram, frustum, modelMatrix, modelMatrix, viewPosition, lodMeshes, updateCulling, true);
+}
+
+auto Model::DrawNode(const unsigned int index, Shader& shaderProgram, FrustumG& frustum, const glm::mat4& modelMatrix, const glm::mat4& parentMatrix,
+	const glm::vec3& viewPosition, std::vector<Mesh>& lodMeshes, const bool updateCulling, bool testFrustum) -> void
+{
+	const auto& node = nodes[index];
+	if (node.empty) return;
+
+	// One test rejects the whole subtree, once a node is fully inside its descendants are too
+	if (updateCulling && testFrustum)
+	{
+		glm::vec3 min, max;
+		TransformBounds(modelMatrix, node.boundsMin, node.boundsMax, min, max);
+
+		const auto result = frustum.boxInFrustum(min, max);
+		if (result == FrustumG::OUTSIDE) return;
+		if (result == FrustumG::INSIDE) testFrustum = false;
+	}
+
+	const auto nodeMatrix = parentMatrix * node.localTransform;
+
+	if (node.meshCount > 0)
+	{
+		for (auto m = node.firstMesh; m < node.firstMesh + node.meshCount; ++m)
+		{
+			lodMeshes[m].Draw(shaderProgram, frustum, nodeMatrix, viewPosition, updateCulling);
+		}
+	}
+
+	for (auto c = node.firstChild; c < node.firstChild + node.childCount; ++c)
+	{
+		DrawNode(c, shaderProgram, frustum, modelMatrix, nodeMatrix, viewPosition, lodMeshes, updateCulling, testFrustum);
+	}
+}
+
+// Build one simplified level per entry of screenSizes (pixels, descending). Level i + 1 is
+// used below screenSizes[i]; each level clusters on a grid twice as coarse as the last.
+// Every level simplifies meshes one to one, so the nodes' mesh ranges index it as well.
+auto Model::GenerateLods(const std::vector<float>& screenSizes) -> void
+{
+	lods.clear();
+
+	const auto diagonal = glm::length(boundsMax - boundsMin);
+	auto cellSize = diagonal / 64.0f;
+
+	for (auto screenSize : screenSizes)
+	{
+		cellSize *= 2.0f;
+
+		auto lod = ModelLod();
+		lod.switchScreenSize = screenSize;
+		for (auto& mesh : meshes)
+		{
+			lod.meshes.push_back(SimplifyMesh(mesh, cellSize));
+			lod.meshes.back().doubleSided_ = mesh.doubleSided_;
+		}
+		lods.push_back(lod);
+	}
+}
+
+auto Model::SetDoubleSided(const bool doubleSided) -> void
+{
+	for (auto& mesh : meshes)
+	{
+		mesh.doubleSided_ = doubleSided;
+	}
+
+	for (auto& lod : lods)
+	{
+		for (auto& mesh : lod.meshes)
+		{
+			mesh.doubleSided_ = doubleSided;
+		}
+	}
+}
+
+auto Model::LodCount() const -> int
+{
+	return static_cast<int>(lods.size()) + 1;
+}
+
+// Projected size (pixels) below which a level replaces the one before it
+auto Model::LodSwitchSize(const int lod) const -> float
+{
+	if (lod <= 0 || lod > static_cast<int>(lods.size())) return 0.0f;
+	return lods[lod - 1].switchScreenSize;
+}
+
+auto Model::LodMeshes(const int lod) -> std::vector<Mesh>&
+{
+	if (lod <= 0 || lods.empty()) return meshes;
+	return lods[glm::min(lod, static_cast<int>(lods.size())) - 1].meshes;
+}
+
 
 auto Model::TextureFromFile(const char *path, const std::string &directory) const -> unsigned int
 {
@@ -190,7 +487,7 @@ auto Model::TextureFromFile(const char *path, const std::string &directory) cons
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::BindTexture(0, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -3,23 +3,84 @@
 #include "Mesh.h"
 #include <assimp/scene.h>
 
+// A coarser version of every mesh, used once the model covers fewer than switchScreenSize pixels
+struct ModelLod
+{
+	std::vector<Mesh> meshes;
+	float switchScreenSize;
+};
+
+// One aiNode of the imported scene. Nodes are stored breadth first in a flat array,
+// so the children of a node and the meshes it owns are contiguous ranges.
+struct ModelNode
+{
+	int parent;
+	glm::mat4 localTransform;
+	unsigned int firstChild;
+	unsigned int childCount;
+	unsigned int firstMesh;
+	unsigned int meshCount;
+
+	// Model space bounds of the node's meshes and all of its descendants
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	bool empty;
+};
+
 class Model
 {
 private:
 	std::string directory_;
 	std::vector<Texture> loadedTextures_;
 
+	// Material of each aiMaterial index, built on first use
+	std::vector<std::shared_ptr<Material>> materials_;
+
+	// Scratch per-node instance transforms
+	std::vector<glm::mat4> instanceTransforms_;
+
+	// How the meshes store their vertices
+	VertexLayout layout_ = VertexLayout::Standard();
+
 	auto LoadModel(std::string path) -> void;
 	auto ProcessNode(aiNode *node, const aiScene * scene) -> void;
+	auto DrawNode(unsigned int index, Shader & shaderProgram, FrustumG & frustum, const glm::mat4 & modelMatrix, const glm::mat4 & parentMatrix,
+		const glm::vec3 & viewPosition, std::vector<Mesh> & lodMeshes, bool updateCulling, bool testFrustum) -> void;
 	auto ProcessMesh(aiMesh * mesh, const aiScene *scene)->Mesh;
+	auto ComputeBounds() -> void;
+	auto LoadMaterial(unsigned int index, const aiScene * scene) -> std::shared_ptr<Material>;
 	auto LoadTextureMaterials(aiMaterial * material, aiTextureType textureType, std::string typeName) -> std::vector<Texture>;
 
 public:
 	std::vector<Mesh> meshes;
-	Model(const char * path);
+
+	// Node hierarchy, nodes[0] is the root
+	std::vector<ModelNode> nodes;
+
+	// Simplified levels of detail, meshes is level 0
+	std::vector<ModelLod> lods;
+
+	// Object space bounds of all meshes
+	glm::vec3 boundsMin = glm::vec3(0);
+	glm::vec3 boundsMax = glm::vec3(0);
+
+	Model(const char * path, const VertexLayout & layout = VertexLayout::Standard());
 	Model() = default;
 
-	auto Draw(Shader shaderProgram) -> void;
+	auto Draw(Shader shaderProgram, int lod = 0) -> void;
+	auto Draw(Shader shaderProgram, const glm::mat4 & modelMatrix, int lod = 0) -> void;
+	auto Draw(Shader shaderProgram, FrustumG & frustum, const glm::mat4 & modelMatrix, const glm::vec3 & viewPosition, int lod = 0, bool updateCulling = true) -> void;
+
+	auto DrawInstanced(Shader shaderProgram, const std::vector<glm::mat4> & transforms, const std::vector<glm::vec4> & params = {}, int lod = 0) -> void;
+
+	// Draw every mesh, at every level of detail, without face culling
+	auto SetDoubleSided(bool doubleSided) -> void;
+
+	// Levels of detail
+	auto GenerateLods(const std::vector<float> & screenSizes) -> void;
+	auto LodCount() const -> int;
+	auto LodSwitchSize(int lod) const -> float;
+	auto LodMeshes(int lod) -> std::vector<Mesh> &;
 	auto TextureFromFile(const char* path, const std::string& directory) const -> unsigned int;
 };
 
@@ -9,7 +9,7 @@ void Plane::set3Points( glm::vec3 &v1,  glm::vec3 &v2,  glm::vec3 &v3) {
 	auto aux1 = v1 - v2;
 	auto aux2 = v3 - v2;
 
-	normal = aux2 * aux1;
+	normal = glm::cross(aux2, aux1);
 
 	normal = glm::normalize(normal);
 	point = glm::vec3(v2);
@@ -28,7 +28,7 @@ void Plane::setCoefficients(float a, float b, float c, float d) {
 	// set the normal vector
 	normal = glm::vec3(a,b,c);
 	//compute the lenght of the vector
-	auto l = normal.length();
+	auto l = glm::length(normal);
 	// normalize the vector
 	normal = glm::vec3(a/l,b/l,c/l);
 	// and divide d by th length as well
@@ -0,0 +1,422 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <iostream>
+#include "GLState.h"
+
+auto RenderTextureDesc::operator==(const RenderTextureDesc& other) const -> bool
+{
+	return width == other.width && height == other.height && internalFormat == other.internalFormat
+		&& format == other.format && type == other.type && filter == other.filter && wrap == other.wrap;
+}
+
+RenderGraph::~RenderGraph()
+{
+	for (auto& framebuffer : framebuffers_)
+	{
+		GLState::DeleteFramebuffer(framebuffer.second);
+	}
+	for (auto& pooled : pool_)
+	{
+		GLState::DeleteTexture(pooled.texture);
+	}
+}
+
+auto RenderGraph::Reset() -> void
+{
+	resources_.clear();
+	passes_.clear();
+	order_.clear();
+	compiled_ = false;
+	stats_ = RenderGraphStats();
+	++frame_;
+}
+
+auto RenderGraph::CreateTexture(const std::string& name, const RenderTextureDesc& desc) -> RenderResource
+{
+	resources_.push_back(Resource{ name, RESOURCE_TRANSIENT, desc, 0, 0, 0, 0 });
+	return static_cast<RenderResource>(resources_.size() - 1);
+}
+
+auto RenderGraph::ImportTexture(const std::string& name, const unsigned int texture, const int width, const int height) -> RenderResource
+{
+	const auto desc = RenderTextureDesc{ width, height, 0, 0, 0, 0, 0 };
+	resources_.push_back(Resource{ name, RESOURCE_IMPORTED, desc, texture, 0, 0, 0 });
+	return static_cast<RenderResource>(resources_.size() - 1);
+}
+
+auto RenderGraph::ImportBackbuffer(const std::string& name, const int width, const int height) -> RenderResource
+{
+	const auto desc = RenderTextureDesc{ width, height, 0, 0, 0, 0, 0 };
+	resources_.push_back(Resource{ name, RESOURCE_BACKBUFFER, desc, 0, 0, 0, 0 });
+	return static_cast<RenderResource>(resources_.size() - 1);
+}
+
+auto RenderGraph::AddPass(const std::string& name, const std::vector<RenderResource>& reads, const std::vector<RenderResource>& writes, RenderPassFunction execute) -> void
+{
+	auto pass = Pass{ name, {}, {}, std::move(execute), true };
+
+	// Undeclared resources are dropped, e.g. an optional input that wasn't created
+	for (auto resource : reads)
+	{
+		if (resource >= resources_.size()) continue;
+		pass.reads.push_back(resource);
+		++resources_[resource].readers;
+	}
+	for (auto resource : writes)
+	{
+		if (resource < resources_.size()) pass.writes.push_back(resource);
+	}
+
+	passes_.push_back(std::move(pass));
+	compiled_ = false;
+}
+
+auto RenderGraph::Compile() -> void
+{
+	Cull();
+	Sort();
+	Allocate();
+	Retire();
+	compiled_ = true;
+}
+
+// A pass stays while one of its writes is read by a live pass or leaves the graph.
+// Culling a pass releases its reads, which may leave their writers unused in turn.
+auto RenderGraph::Cull() -> void
+{
+	auto culled = true;
+	while (culled)
+	{
+		culled = false;
+		for (auto& pass : passes_)
+		{
+			if (!pass.live) continue;
+
+			const auto used = std::any_of(pass.writes.begin(), pass.writes.end(), [this](const RenderResource resource)
+			{
+				return resources_[resource].kind != RESOURCE_TRANSIENT || resources_[resource].readers > 0;
+			});
+			if (used) continue;
+
+			pass.live = false;
+			for (auto resource : pass.reads)
+			{
+				--resources_[resource].readers;
+			}
+			culled = true;
+		}
+	}
+}
+
+// Declaration order, except that a pass goes after the passes producing what it reads
+// and after earlier users of what it writes. The earliest declared ready pass goes first.
+auto RenderGraph::Sort() -> void
+{
+	const auto passCount = static_cast<unsigned int>(passes_.size());
+	auto dependencies = std::vector<std::vector<unsigned int>>(passCount);
+
+	const auto writes = [this](const unsigned int pass, const RenderResource resource)
+	{
+		return std::find(passes_[pass].writes.begin(), passes_[pass].writes.end(), resource) != passes_[pass].writes.end();
+	};
+	const auto reads = [this](const unsigned int pass, const RenderResource resource)
+	{
+		return std::find(passes_[pass].reads.begin(), passes_[pass].reads.end(), resource) != passes_[pass].reads.end();
+	};
+
+	for (unsigned int pass = 0; pass < passCount; ++pass)
+	{
+		if (!passes_[pass].live) continue;
+
+		for (auto resource : passes_[pass].reads)
+		{
+			// Producers declared later count when none was declared before
+			auto earlierWriter = false;
+			for (unsigned int other = 0; other < pass; ++other)
+			{
+				if (passes_[other].live && writes(other, resource))
+				{
+					dependencies[pass].push_back(other);
+					earlierWriter = true;
+				}
+			}
+			if (earlierWriter) continue;
+
+			for (auto other = pass + 1; other < passCount; ++other)
+			{
+				if (passes_[other].live && writes(other, resource)) dependencies[pass].push_back(other);
+			}
+		}
+	}
+
+	// Separate loop, reads of this pass's output must be known first
+	for (unsigned int pass = 0; pass < passCount; ++pass)
+	{
+		if (!passes_[pass].live) continue;
+
+		for (auto resource : passes_[pass].writes)
+		{
+			for (unsigned int other = 0; other < pass; ++other)
+			{
+				if (!passes_[other].live || !(writes(other, resource) || reads(other, resource))) continue;
+
+				// A reader declared before its producer waits for this pass instead
+				const auto& waits = dependencies[other];
+				if (std::find(waits.begin(), waits.end(), pass) != waits.end()) continue;
+
+				dependencies[pass].push_back(other);
+			}
+		}
+	}
+
+	order_.clear();
+	auto scheduled = std::vector<bool>(passCount, false);
+	for (unsigned int pass = 0; pass < passCount; ++pass)
+	{
+		if (!passes_[pass].live) scheduled[pass] = true;
+	}
+
+	for (;;)
+	{
+		auto next = passCount;
+		auto remaining = false;
+		for (unsigned int pass = 0; pass < passCount && next == passCount; ++pass)
+		{
+			if (scheduled[pass]) continue;
+			remaining = true;
+
+			const auto ready = std::all_of(dependencies[pass].begin(), dependencies[pass].end(), [&scheduled](const unsigned int dependency)
+			{
+				return scheduled[dependency];
+			});
+			if (ready) next = pass;
+		}
+		if (!remaining) break;
+
+		if (next == passCount)
+		{
+			// A cycle, run what's left as declared
+			std::cout << "Render graph: cyclic pass dependencies, falling back to declaration order" << std::endl;
+			for (unsigned int pass = 0; pass < passCount; ++pass)
+			{
+				if (!scheduled[pass]) order_.push_back(pass);
+			}
+			break;
+		}
+
+		scheduled[next] = true;
+		order_.push_back(next);
+	}
+}
+
+// Transients get a texture at their first use and give it back after their last, so a
+// later transient with the same description can alias it
+auto RenderGraph::Allocate() -> void
+{
+	const auto unused = ~0u;
+	for (auto& resource : resources_)
+	{
+		resource.firstUse = unused;
+		resource.lastUse = 0;
+	}
+
+	for (unsigned int position = 0; position < order_.size(); ++position)
+	{
+		const auto& pass = passes_[order_[position]];
+		for (auto list : { &pass.reads, &pass.writes })
+		{
+			for (auto resource : *list)
+			{
+				auto& used = resources_[resource];
+				used.firstUse = std::min(used.firstUse, position);
+				used.lastUse = std::max(used.lastUse, position);
+			}
+		}
+	}
+
+	auto allocated = std::vector<unsigned int>();
+	for (unsigned int position = 0; position < order_.size(); ++position)
+	{
+		for (auto& resource : resources_)
+		{
+			if (resource.kind != RESOURCE_TRANSIENT || resource.firstUse != position) continue;
+
+			resource.texture = AcquireTexture(resource.desc);
+			++stats_.transientTextures;
+			if (std::find(allocated.begin(), allocated.end(), resource.texture) == allocated.end())
+			{
+				allocated.push_back(resource.texture);
+			}
+		}
+
+		for (auto& resource : resources_)
+		{
+			if (resource.kind == RESOURCE_TRANSIENT && resource.firstUse != unused && resource.lastUse == position)
+			{
+				ReleaseTexture(resource.texture);
+			}
+		}
+	}
+
+	stats_.passes = static_cast<unsigned int>(passes_.size());
+	stats_.culledPasses = static_cast<unsigned int>(passes_.size() - order_.size());
+	stats_.allocatedTextures = static_cast<unsigned int>(allocated.size());
+}
+
+// Delete pooled textures nobody used for a while, along with their framebuffers
+auto RenderGraph::Retire() -> void
+{
+	for (unsigned int i = 0; i < pool_.size();)
+	{
+		if (frame_ - pool_[i].lastUsedFrame <= RENDER_GRAPH_RETIRE_FRAMES)
+		{
+			++i;
+			continue;
+		}
+
+		const auto texture = pool_[i].texture;
+		for (auto framebuffer = framebuffers_.begin(); framebuffer != framebuffers_.end();)
+		{
+			if (std::find(framebuffer->first.begin(), framebuffer->first.end(), texture) == framebuffer->first.end())
+			{
+				++framebuffer;
+				continue;
+			}
+
+			GLState::DeleteFramebuffer(framebuffer->second);
+			framebuffer = framebuffers_.erase(framebuffer);
+		}
+
+		GLState::DeleteTexture(texture);
+		pool_[i] = pool_.back();
+		pool_.pop_back();
+	}
+}
+
+auto RenderGraph::AcquireTexture(const RenderTextureDesc& desc) -> unsigned int
+{
+	for (auto& pooled : pool_)
+	{
+		if (pooled.inUse || !(pooled.desc == desc)) continue;
+
+		pooled.inUse = true;
+		pooled.lastUsedFrame = frame_;
+		return pooled.texture;
+	}
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	GLState::BindTexture(0, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, desc.format, desc.type, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, desc.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, desc.wrap);
+
+	pool_.push_back(PooledTexture{ desc, texture, frame_, true });
+	return texture;
+}
+
+auto RenderGraph::ReleaseTexture(const unsigned int texture) -> void
+{
+	for (auto& pooled : pool_)
+	{
+		if (pooled.texture == texture) pooled.inUse = false;
+	}
+}
+
+auto RenderGraph::Execute() -> void
+{
+	if (!compiled_) Compile();
+
+	for (auto pass : order_)
+	{
+		BindTargets(passes_[pass]);
+		if (passes_[pass].execute) passes_[pass].execute(*this);
+	}
+}
+
+auto RenderGraph::BindTargets(const Pass& pass) -> void
+{
+	if (pass.writes.empty()) return;
+
+	for (auto resource : pass.writes)
+	{
+		if (resources_[resource].kind != RESOURCE_BACKBUFFER) continue;
+
+		GLState::BindFramebuffer(0);
+		GLState::Viewport(0, 0, resources_[resource].desc.width, resources_[resource].desc.height);
+		return;
+	}
+
+	const auto& target = resources_[pass.writes.front()].desc;
+	GLState::BindFramebuffer(Framebuffer(pass));
+	GLState::Viewport(0, 0, target.width, target.height);
+}
+
+// One framebuffer per set of written textures, depth formats go to the depth attachment
+auto RenderGraph::Framebuffer(const Pass& pass) -> unsigned int
+{
+	auto textures = std::vector<unsigned int>();
+	for (auto resource : pass.writes)
+	{
+		textures.push_back(resources_[resource].texture);
+	}
+
+	const auto existing = framebuffers_.find(textures);
+	if (existing != framebuffers_.end()) return existing->second;
+
+	unsigned int framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	GLState::BindFramebuffer(framebuffer);
+
+	auto drawBuffers = std::vector<GLenum>();
+	for (auto resource : pass.writes)
+	{
+		const auto& written = resources_[resource];
+		if (IsDepthFormat(written.desc.internalFormat))
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, written.texture, 0);
+			continue;
+		}
+
+		const auto attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, written.texture, 0);
+		drawBuffers.push_back(attachment);
+	}
+
+	if (drawBuffers.empty())
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	else
+	{
+		glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Render graph: framebuffer of pass " << pass.name << " is incomplete" << std::endl;
+	}
+
+	framebuffers_[textures] = framebuffer;
+	return framebuffer;
+}
+
+auto RenderGraph::IsDepthFormat(const GLenum format) -> bool
+{
+	return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24
+		|| format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F
+		|| format == GL_DEPTH_STENCIL || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+auto RenderGraph::Texture(const RenderResource resource) const -> unsigned int
+{
+	return resource < resources_.size() ? resources_[resource].texture : 0;
+}
+
+auto RenderGraph::Stats() const -> RenderGraphStats
+{
+	return stats_;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Handle of a resource declared this frame
+typedef unsigned int RenderResource;
+const RenderResource RENDER_RESOURCE_INVALID = ~0u;
+
+// Frames a pooled texture may stay unused before it is deleted
+const unsigned int RENDER_GRAPH_RETIRE_FRAMES = 3;
+
+// Storage of a transient render target. Targets with equal descriptions may share one
+// texture when their lifetimes within the frame don't overlap.
+struct RenderTextureDesc
+{
+	int width;
+	int height;
+	GLenum internalFormat;
+	GLenum format;
+	GLenum type;
+	GLint filter;
+	GLint wrap;
+
+	auto operator==(const RenderTextureDesc & other) const -> bool;
+};
+
+struct RenderGraphStats
+{
+	unsigned int passes;
+	unsigned int culledPasses;
+	// Transient textures declared by live passes, and the pooled textures backing them
+	unsigned int transientTextures;
+	unsigned int allocatedTextures;
+};
+
+class RenderGraph;
+typedef std::function<void(const RenderGraph &)> RenderPassFunction;
+
+// The frame as passes that declare the resources they read and write. Compile orders the
+// passes by their dependencies, culls every pass whose writes nobody reads and backs the
+// transient textures of the remaining passes with pooled textures, reusing a texture once
+// its last reader is done. Transients of culled passes are never allocated, and pooled
+// textures are deleted after RENDER_GRAPH_RETIRE_FRAMES unused frames.
+// Execute binds each pass's framebuffer and viewport before calling it, the pass does its
+// own clears. Writing the backbuffer or an imported texture keeps a pass alive.
+// Declare everything again every frame, starting with Reset.
+class RenderGraph
+{
+public:
+	RenderGraph() = default;
+	~RenderGraph();
+	RenderGraph(const RenderGraph &) = delete;
+	auto operator=(const RenderGraph &) -> RenderGraph & = delete;
+
+	// Forget the previous frame's passes and resources, the texture pool is kept
+	auto Reset() -> void;
+
+	auto CreateTexture(const std::string & name, const RenderTextureDesc & desc) -> RenderResource;
+	// Textures and framebuffers owned elsewhere
+	auto ImportTexture(const std::string & name, unsigned int texture, int width, int height) -> RenderResource;
+	auto ImportBackbuffer(const std::string & name, int width, int height) -> RenderResource;
+
+	auto AddPass(const std::string & name, const std::vector<RenderResource> & reads, const std::vector<RenderResource> & writes, RenderPassFunction execute) -> void;
+
+	auto Compile() -> void;
+	// Run the live passes in order, compiles first when needed
+	auto Execute() -> void;
+
+	// GL texture behind a resource, valid while the graph executes
+	auto Texture(RenderResource resource) const -> unsigned int;
+	auto Stats() const -> RenderGraphStats;
+
+private:
+	enum Resource_Kind
+	{
+		RESOURCE_TRANSIENT,
+		RESOURCE_IMPORTED,
+		RESOURCE_BACKBUFFER
+	};
+
+	struct Resource
+	{
+		std::string name;
+		Resource_Kind kind;
+		RenderTextureDesc desc;
+		unsigned int texture;
+
+		// Passes reading it and, after Compile, the first and last live pass using it
+		unsigned int readers;
+		unsigned int firstUse;
+		unsigned int lastUse;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::vector<RenderResource> reads;
+		std::vector<RenderResource> writes;
+		RenderPassFunction execute;
+		bool live;
+	};
+
+	struct PooledTexture
+	{
+		RenderTextureDesc desc;
+		unsigned int texture;
+		unsigned long long lastUsedFrame;
+		bool inUse;
+	};
+
+	std::vector<Resource> resources_;
+	std::vector<Pass> passes_;
+	std::vector<unsigned int> order_;
+	bool compiled_ = false;
+	RenderGraphStats stats_ = RenderGraphStats();
+
+	std::vector<PooledTexture> pool_;
+	// Framebuffers by the textures attached to them
+	std::map<std::vector<unsigned int>, unsigned int> framebuffers_;
+	unsigned long long frame_ = 0;
+
+	auto Cull() -> void;
+	auto Sort() -> void;
+	auto Allocate() -> void;
+	auto Retire() -> void;
+	auto AcquireTexture(const RenderTextureDesc & desc) -> unsigned int;
+	auto ReleaseTexture(unsigned int texture) -> void;
+	auto BindTargets(const Pass & pass) -> void;
+	auto Framebuffer(const Pass & pass) -> unsigned int;
+	static auto IsDepthFormat(GLenum format) -> bool;
+};
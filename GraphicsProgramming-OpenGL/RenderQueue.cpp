@@ -0,0 +1,264 @@
+#include "RenderQueue.h"
+#include "Mesh.h"
+#include "MeshPool.h"
+#include "GLState.h"
+#include <glm/glm.hpp>
+
+thread_local RenderQueue * RenderQueue::recording_ = nullptr;
+
+auto RenderQueue::Begin(const Render_Pass pass, const glm::vec3& viewPosition, const float farDistance) -> void
+{
+	pass_ = pass;
+	viewPosition_ = viewPosition;
+	farDistance_ = farDistance > 0.0f ? farDistance : 1.0f;
+	recording_ = this;
+}
+
+auto RenderQueue::End() -> void
+{
+	if (recording_ == this) recording_ = nullptr;
+}
+
+auto RenderQueue::Recording() -> RenderQueue *
+{
+	return recording_;
+}
+
+auto RenderQueue::MakeKey(const Shader& shader, const Mesh& mesh, const glm::mat4& model) const -> unsigned long long
+{
+	// Depth of the mesh's centre, quantised front to back
+	const auto center = glm::vec3(model * glm::vec4((mesh.boundsMin_ + mesh.boundsMax_) * 0.5f, 1.0f));
+	const auto depth = glm::clamp(glm::distance(center, viewPosition_) / farDistance_, 0.0f, 1.0f);
+	const auto depthBits = static_cast<unsigned long long>(depth * 0x7FFFFF);
+
+	return (static_cast<unsigned long long>(pass_ & 0xF) << 60)
+		| (static_cast<unsigned long long>(shader.ID & 0xFF) << 52)
+		| (static_cast<unsigned long long>(mesh.material_->id & 0xFFFF) << 36)
+		| (static_cast<unsigned long long>(mesh.pool_->Buffers().vertex & 0x7FF) << 25)
+		| (static_cast<unsigned long long>(mesh.IndexType() == GL_UNSIGNED_SHORT) << 24)
+		| (static_cast<unsigned long long>(mesh.doubleSided_) << 23)
+		| depthBits;
+}
+
+auto RenderQueue::Submit(const Shader& shader, Mesh& mesh, const glm::mat4& model) -> void
+{
+	if (!mesh.Drawable()) return;
+
+	auto packet = DrawPacket{ MakeKey(shader, mesh, model), &mesh, shader, model, 0, 0 };
+	packets_.push_back(packet);
+	sorted_ = false;
+}
+
+auto RenderQueue::Submit(const Shader& shader, Mesh& mesh, const glm::mat4& model, const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets) -> void
+{
+	if (counts.empty() || !mesh.Drawable()) return;
+
+	auto packet = DrawPacket{ MakeKey(shader, mesh, model), &mesh, shader, model,
+		static_cast<unsigned int>(rangeCounts_.size()), static_cast<unsigned int>(counts.size()) };
+	rangeCounts_.insert(rangeCounts_.end(), counts.begin(), counts.end());
+	rangeOffsets_.insert(rangeOffsets_.end(), offsets.begin(), offsets.end());
+	packets_.push_back(packet);
+	sorted_ = false;
+}
+
+auto RenderQueue::Append(RenderQueue& other) -> void
+{
+	if (other.packets_.empty()) return;
+
+	// Range slices move with the packets, shifted past the ranges already here
+	const auto rangeBase = static_cast<unsigned int>(rangeCounts_.size());
+	packets_.reserve(packets_.size() + other.packets_.size());
+	for (auto& packet : other.packets_)
+	{
+		packets_.push_back(packet);
+		packets_.back().firstRange += rangeBase;
+	}
+	rangeCounts_.insert(rangeCounts_.end(), other.rangeCounts_.begin(), other.rangeCounts_.end());
+	rangeOffsets_.insert(rangeOffsets_.end(), other.rangeOffsets_.begin(), other.rangeOffsets_.end());
+	sorted_ = false;
+
+	other.packets_.clear();
+	other.rangeCounts_.clear();
+	other.rangeOffsets_.clear();
+	other.sorted_ = false;
+}
+
+auto RenderQueue::Prepare() -> void
+{
+	if (sorted_ || packets_.empty()) return;
+
+	Sort();
+	sorted_ = true;
+}
+
+// LSD radix sort of the keys, one byte per pass. Passes where every key shares the same
+// byte are skipped, which is most of them for a small scene.
+auto RenderQueue::Sort() -> void
+{
+	sortKeys_.resize(packets_.size());
+	sortScratch_.resize(packets_.size());
+	for (unsigned int i = 0; i < packets_.size(); ++i)
+	{
+		sortKeys_[i] = std::make_pair(packets_[i].key, i);
+	}
+
+	for (auto shift = 0; shift < 64; shift += 8)
+	{
+		unsigned int counts[256] = {};
+		for (auto& entry : sortKeys_)
+		{
+			++counts[(entry.first >> shift) & 0xFF];
+		}
+
+		if (counts[(sortKeys_[0].first >> shift) & 0xFF] == sortKeys_.size()) continue;
+
+		auto offset = 0u;
+		for (auto& count : counts)
+		{
+			const auto bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+
+		for (auto& entry : sortKeys_)
+		{
+			sortScratch_[counts[(entry.first >> shift) & 0xFF]++] = entry;
+		}
+		sortKeys_.swap(sortScratch_);
+	}
+}
+
+auto RenderQueue::Execute() -> void
+{
+	End();
+	stats = RenderQueueStats();
+	stats.packets = static_cast<unsigned int>(packets_.size());
+
+	if (!packets_.empty())
+	{
+		Prepare();
+
+		auto currentProgram = 0u;
+		MeshPool * currentPool = nullptr;
+		auto currentIndexType = GLenum(0);
+		const Material * currentMaterial = nullptr;
+
+		for (unsigned int i = 0; i < sortKeys_.size();)
+		{
+			auto& packet = packets_[sortKeys_[i].second];
+			auto& mesh = *packet.mesh;
+
+			if (packet.shader.ID != currentProgram)
+			{
+				packet.shader.Use();
+				currentProgram = packet.shader.ID;
+				currentMaterial = nullptr;
+				++stats.programChanges;
+			}
+
+			if (mesh.material_.get() != currentMaterial)
+			{
+				mesh.material_->Bind(packet.shader);
+				currentMaterial = mesh.material_.get();
+				++stats.materialChanges;
+			}
+
+			if (mesh.pool_ != currentPool || mesh.IndexType() != currentIndexType)
+			{
+				mesh.pool_->Bind(mesh.IndexType());
+				currentPool = mesh.pool_;
+				currentIndexType = mesh.IndexType();
+				++stats.poolChanges;
+			}
+
+			i = ExecutePooled(i);
+		}
+	}
+
+	Clear();
+}
+
+auto RenderQueue::Clear() -> void
+{
+	packets_.clear();
+	rangeCounts_.clear();
+	rangeOffsets_.clear();
+	sorted_ = false;
+}
+
+auto RenderQueue::ExecuteDepth(Shader shader) -> void
+{
+	End();
+	if (packets_.empty()) return;
+
+	Prepare();
+	shader.Use();
+
+	MeshPool * currentPool = nullptr;
+	auto currentIndexType = GLenum(0);
+	for (unsigned int i = 0; i < sortKeys_.size();)
+	{
+		auto& mesh = *packets_[sortKeys_[i].second].mesh;
+		if (mesh.pool_ != currentPool || mesh.IndexType() != currentIndexType)
+		{
+			mesh.pool_->BindPositions(mesh.IndexType());
+			currentPool = mesh.pool_;
+			currentIndexType = mesh.IndexType();
+		}
+
+		i = ExecutePooled(i, &shader);
+	}
+}
+
+// Every following packet in the same pool with the same program and textures becomes one
+// command per index range, all issued by a single multi draw. Bindless materials are
+// selected per instance, so then the material does not end the run either. With a depth
+// shader only the pool and face culling end a run. Returns the first packet that was not part of the run.
+auto RenderQueue::ExecutePooled(const unsigned int first, const Shader* depthShader) -> unsigned int
+{
+	const auto& firstPacket = packets_[sortKeys_[first].second];
+	auto& pool = *firstPacket.mesh->pool_;
+
+	poolCommands_.clear();
+	poolInstances_.clear();
+
+	const auto bindless = Material::Residency() == RESIDENCY_BINDLESS;
+
+	auto i = first;
+	for (; i < sortKeys_.size(); ++i)
+	{
+		const auto& packet = packets_[sortKeys_[i].second];
+		const auto& mesh = *packet.mesh;
+		if (mesh.pool_ != &pool || mesh.IndexType() != firstPacket.mesh->IndexType()) break;
+		if (mesh.doubleSided_ != firstPacket.mesh->doubleSided_) break;
+		if (depthShader == nullptr && packet.shader.ID != firstPacket.shader.ID) break;
+		if (depthShader == nullptr && !bindless && mesh.material_ != firstPacket.mesh->material_) break;
+
+		const auto instance = static_cast<GLuint>(poolInstances_.size());
+		auto instanceData = InstanceData();
+		instanceData.Transform = packet.model * mesh.positionTransform_;
+		instanceData.Params = glm::vec4(1.0f);
+		instanceData.MaterialIndex = static_cast<int>(mesh.material_->id);
+		poolInstances_.push_back(instanceData);
+
+		if (packet.rangeCount == 0)
+		{
+			poolCommands_.push_back(DrawElementsIndirectCommand{ static_cast<GLuint>(mesh.indices_.size()), 1, mesh.FirstIndex(), mesh.BaseVertex(), instance });
+			continue;
+		}
+
+		for (auto r = packet.firstRange; r < packet.firstRange + packet.rangeCount; ++r)
+		{
+			const auto firstIndex = static_cast<GLuint>(reinterpret_cast<size_t>(rangeOffsets_[r]) / sizeof(unsigned int));
+			poolCommands_.push_back(DrawElementsIndirectCommand{ static_cast<GLuint>(rangeCounts_[r]), 1, mesh.FirstIndex() + firstIndex, mesh.BaseVertex(), instance });
+		}
+	}
+
+	const auto indexType = firstPacket.mesh->IndexType();
+	firstPacket.mesh->ApplyFaceCulling();
+	if (depthShader != nullptr) stats.draws += pool.Draw(*depthShader, poolCommands_, poolInstances_, indexType, true);
+	else stats.draws += pool.Draw(firstPacket.shader, poolCommands_, poolInstances_, indexType);
+	stats.pooledPackets += i - first;
+
+	return i;
+}
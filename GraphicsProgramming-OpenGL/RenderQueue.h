@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "Shader.h"
+#include "GLExtensions.h"
+#include "Mesh.h"
+
+// Passes in execution order, the top bits of the sort key
+enum Render_Pass
+{
+	PASS_SHADOW = 0,
+	PASS_OPAQUE = 1
+};
+
+// One deferred mesh draw
+struct DrawPacket
+{
+	unsigned long long key;
+	Mesh * mesh;
+	Shader shader;
+	glm::mat4 model;
+
+	// Slice of the queue's range pool, rangeCount 0 draws the whole mesh
+	unsigned int firstRange;
+	unsigned int rangeCount;
+};
+
+// State changes made by the last Execute
+struct RenderQueueStats
+{
+	unsigned int packets;
+	// GL draw calls issued, whether multi draw indirect or the fallback
+	unsigned int draws;
+	unsigned int programChanges;
+	unsigned int materialChanges;
+	// Switches between MeshPools or index widths, a buffer swap on the shared VAO with vertex attrib binding
+	unsigned int poolChanges;
+	// Packets folded into multi draws of a MeshPool
+	unsigned int pooledPackets;
+};
+
+// While a queue is recording, Mesh draws submit packets instead of drawing. Recording is
+// per thread, so worker threads can each fill their own queue and Append them to the one
+// that is executed. Recording touches no GL state. The packets
+// are radix sorted by a 64 bit key and executed with redundant program, material and pool
+// changes skipped. Runs of packets whose meshes live in the same MeshPool and index heap are
+// drawn with one glMultiDrawElementsIndirect. Meshes outside any pool are not drawn.
+// Key layout, most significant first:
+//   pass (4) | shader program (8) | material (16) | vertex buffer (11) | 16 bit indices (1) | double sided (1) | front-to-back depth (23)
+class RenderQueue
+{
+public:
+	RenderQueueStats stats = RenderQueueStats();
+
+	// Start recording packets for a pass, depth is measured from viewPosition up to farDistance
+	auto Begin(Render_Pass pass, const glm::vec3 & viewPosition, float farDistance) -> void;
+	auto End() -> void;
+
+	auto Submit(const Shader & shader, Mesh & mesh, const glm::mat4 & model) -> void;
+	auto Submit(const Shader & shader, Mesh & mesh, const glm::mat4 & model, const std::vector<GLsizei> & counts, const std::vector<const void *> & offsets) -> void;
+
+	// Move another queue's packets to the end of this one, leaving it empty
+	auto Append(RenderQueue & other) -> void;
+
+	// Sort the recorded packets, may run on any thread. Execute sorts whatever is left.
+	auto Prepare() -> void;
+
+	// Sort and draw everything recorded, then clear the queue
+	auto Execute() -> void;
+
+	// Draw everything recorded with one program and no material binds, keeping the packets
+	// for Execute. Meant for depth only passes: runs are only split by MeshPool, index heap
+	// and face culling, and the pool's position stream is drawn instead of the full vertices.
+	auto ExecuteDepth(Shader shader) -> void;
+
+	// Drop everything recorded
+	auto Clear() -> void;
+
+	// The queue Mesh draws on this thread are redirected to, nullptr when drawing immediately
+	static auto Recording() -> RenderQueue *;
+
+private:
+	Render_Pass pass_ = PASS_OPAQUE;
+	glm::vec3 viewPosition_ = glm::vec3(0);
+	float farDistance_ = 1.0f;
+
+	std::vector<DrawPacket> packets_;
+	std::vector<GLsizei> rangeCounts_;
+	std::vector<const void *> rangeOffsets_;
+	bool sorted_ = false;
+
+	// Radix sort scratch, (key, packet index) pairs
+	std::vector<std::pair<unsigned long long, unsigned int>> sortKeys_;
+	std::vector<std::pair<unsigned long long, unsigned int>> sortScratch_;
+
+	// Commands and per-draw data for one pooled multi draw
+	std::vector<DrawElementsIndirectCommand> poolCommands_;
+	std::vector<InstanceData> poolInstances_;
+
+	static thread_local RenderQueue * recording_;
+
+	auto MakeKey(const Shader & shader, const Mesh & mesh, const glm::mat4 & model) const -> unsigned long long;
+	auto Sort() -> void;
+	auto ExecutePooled(unsigned int first, const Shader * depthShader = nullptr) -> unsigned int;
+};
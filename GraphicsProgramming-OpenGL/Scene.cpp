@@ -0,0 +1,16 @@
+#include "Scene.h"
+#include <algorithm>
+
+auto Scene::Add(GameObject* object) -> void
+{
+	objects_.push_back(object);
+	object->scene_ = this;
+	Changed();
+}
+
+auto Scene::Remove(GameObject* object) -> void
+{
+	objects_.erase(std::remove(objects_.begin(), objects_.end(), object), objects_.end());
+	if (object->scene_ == this) object->scene_ = nullptr;
+	Changed();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "GameObject.h"
+
+// The objects drawn in the main pass. The list only changes through Add and Remove, so
+// every change reaches the counter caches are keyed on.
+class Scene
+{
+public:
+	auto Add(GameObject * object) -> void;
+	auto Remove(GameObject * object) -> void;
+	auto Objects() const -> const std::vector<GameObject *> & { return objects_; }
+
+	// Changes whenever an object is added, removed or transformed
+	auto ChangeCounter() const -> unsigned long long { return changeCounter_; }
+	// Called by the objects' transform setters
+	auto Changed() -> void { ++changeCounter_; }
+
+private:
+	std::vector<GameObject *> objects_;
+	unsigned long long changeCounter_ = 0;
+};
@@ -2,7 +2,12 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <glm/mat2x2.hpp>
+#include <glm/mat3x3.hpp>
 #include <GLM/mat4x4.hpp>
+#include "UniformBuffer.h"
+#include "GLState.h"
 
 
 Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
@@ -103,69 +108,229 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
 	// Delete the shaders as they are linked into the shader program
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
+
+	ReflectUniforms();
+
+	// Attach whichever shared uniform blocks the program declares to their binding points
+	BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+	BindUniformBlock("LightData", LIGHT_UNIFORM_BINDING);
+	BindUniformBlock("MaterialData", MATERIAL_UNIFORM_BINDING);
+}
+
+auto Shader::BindUniformBlock(const std::string& name, const unsigned int binding) const -> void
+{
+	const auto index = glGetUniformBlockIndex(ID, name.c_str());
+	if (index != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ID, index, binding);
+	}
+}
+
+// Enumerate the active uniforms into the hashed table. Arrays are entered under both
+// "name[0]" and "name", uniforms in blocks have no location and are left out. Names whose
+// hashes collide are moved to collidingSlots, so each still resolves to its own location.
+auto Shader::ReflectUniforms() -> void
+{
+	uniforms_ = std::make_shared<UniformTable>();
+
+	auto count = 0;
+	auto maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	auto name = std::vector<char>(maxLength + 1);
+	auto hashedNames = std::unordered_map<unsigned int, std::string>();
+	for (auto i = 0; i < count; ++i)
+	{
+		auto length = 0;
+		auto size = 0;
+		GLenum type;
+		glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+		const auto location = glGetUniformLocation(ID, name.data());
+		if (location < 0) continue;
+
+		const auto slot = static_cast<int>(uniforms_->entries.size());
+		uniforms_->entries.push_back(UniformTable::Entry{ location, {}, false });
+
+		auto names = std::vector<std::string>{ std::string(name.data(), length) };
+		if (names[0].size() > 3 && names[0].compare(names[0].size() - 3, 3, "[0]") == 0)
+		{
+			names.push_back(names[0].substr(0, names[0].size() - 3));
+		}
+
+		for (auto& uniformName : names)
+		{
+			const auto hash = UniformName::Hash(uniformName.c_str());
+			const auto inserted = uniforms_->slots.emplace(hash, slot);
+			if (inserted.second)
+			{
+				hashedNames.emplace(hash, uniformName);
+				continue;
+			}
+
+			std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION " << uniformName << " and " << hashedNames[hash] << ", looked up by name" << std::endl;
+			if (inserted.first->second >= 0)
+			{
+				uniforms_->collidingSlots.emplace(hashedNames[hash], inserted.first->second);
+				inserted.first->second = -1;
+			}
+			uniforms_->collidingSlots.emplace(uniformName, slot);
+		}
+	}
 }
 
 auto Shader::Use() -> void
 {
-	glUseProgram(ID);
+	GLState::UseProgram(ID);
+}
+
+auto Shader::Uniform(const UniformName name) const -> UniformHandle
+{
+	auto handle = UniformHandle();
+	if (!uniforms_) return handle;
+
+	const auto found = uniforms_->slots.find(name.hash);
+	if (found == uniforms_->slots.end()) return handle;
+
+	auto slot = found->second;
+	if (slot < 0)
+	{
+		const auto colliding = uniforms_->collidingSlots.find(name.name);
+		if (colliding == uniforms_->collidingSlots.end()) return handle;
+		slot = colliding->second;
+	}
+
+	handle.slot = slot;
+	handle.location = uniforms_->entries[slot].location;
+	return handle;
+}
+
+auto Shader::SetShadowing(const bool enabled) const -> void
+{
+	if (!uniforms_) return;
+
+	uniforms_->shadowing = enabled;
+	for (auto& entry : uniforms_->entries)
+	{
+		entry.known = false;
+	}
+}
+
+auto Shader::Changed(const UniformHandle handle, const void* value, const size_t size) const -> bool
+{
+	if (!handle.Valid()) return false;
+	if (!uniforms_->shadowing) return true;
+
+	auto& entry = uniforms_->entries[handle.slot];
+	if (entry.known && std::memcmp(entry.value, value, size) == 0) return false;
+
+	std::memcpy(entry.value, value, size);
+	entry.known = true;
+	return true;
+}
+
+auto Shader::Set(const UniformHandle handle, const bool value) const -> void
+{
+	Set(handle, static_cast<int>(value));
+}
+
+auto Shader::Set(const UniformHandle handle, const int value) const -> void
+{
+	if (Changed(handle, &value, sizeof(value))) glUniform1i(handle.location, value);
+}
+
+auto Shader::Set(const UniformHandle handle, const float value) const -> void
+{
+	if (Changed(handle, &value, sizeof(value))) glUniform1f(handle.location, value);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::vec2& value) const -> void
+{
+	if (Changed(handle, &value[0], sizeof(value))) glUniform2fv(handle.location, 1, &value[0]);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::vec3& value) const -> void
+{
+	if (Changed(handle, &value[0], sizeof(value))) glUniform3fv(handle.location, 1, &value[0]);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::vec4& value) const -> void
+{
+	if (Changed(handle, &value[0], sizeof(value))) glUniform4fv(handle.location, 1, &value[0]);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::mat2& mat) const -> void
+{
+	if (Changed(handle, &mat[0][0], sizeof(mat))) glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::mat3& mat) const -> void
+{
+	if (Changed(handle, &mat[0][0], sizeof(mat))) glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+auto Shader::Set(const UniformHandle handle, const glm::mat4& mat) const -> void
+{
+	if (Changed(handle, &mat[0][0], sizeof(mat))) glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
 }
 
-auto Shader::SetBool(const std::string& name, const bool value) const -> void
+auto Shader::SetBool(const UniformName name, const bool value) const -> void
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), static_cast<int>(value));
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetInt(const std::string& name, const int value) const -> void
+auto Shader::SetInt(const UniformName name, const int value) const -> void
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetFloat(const std::string& name, const float value) const -> void
+auto Shader::SetFloat(const UniformName name, const float value) const -> void
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetVec2(const std::string &name, const glm::vec2 &value) const -> void
+auto Shader::SetVec2(const UniformName name, const glm::vec2 &value) const -> void
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetVec2(const std::string &name, float x, float y) const -> void
+auto Shader::SetVec2(const UniformName name, float x, float y) const -> void
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	Set(Uniform(name), glm::vec2(x, y));
 }
 
-auto Shader::SetVec3(const std::string &name, const glm::vec3 &value) const -> void
+auto Shader::SetVec3(const UniformName name, const glm::vec3 &value) const -> void
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetVec3(const std::string &name, float x, float y, float z) const -> void
+auto Shader::SetVec3(const UniformName name, float x, float y, float z) const -> void
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	Set(Uniform(name), glm::vec3(x, y, z));
 }
 
-auto Shader::SetVec4(const std::string &name, const glm::vec4 &value) const -> void
+auto Shader::SetVec4(const UniformName name, const glm::vec4 &value) const -> void
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	Set(Uniform(name), value);
 }
 
-auto Shader::SetVec4(const std::string &name, float x, float y, float z, float w) -> void
+auto Shader::SetVec4(const UniformName name, float x, float y, float z, float w) -> void
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	Set(Uniform(name), glm::vec4(x, y, z, w));
 }
 
-auto Shader::SetMat2(const std::string &name, const glm::mat2 &mat) const -> void
+auto Shader::SetMat2(const UniformName name, const glm::mat2 &mat) const -> void
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	Set(Uniform(name), mat);
 }
 
-auto Shader::SetMat3(const std::string &name, const glm::mat3 &mat) const -> void
+auto Shader::SetMat3(const UniformName name, const glm::mat3 &mat) const -> void
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	Set(Uniform(name), mat);
 }
 
-auto Shader::SetMat4(const std::string &name, const glm::mat4 &mat) const -> void
+auto Shader::SetMat4(const UniformName name, const glm::mat4 &mat) const -> void
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	Set(Uniform(name), mat);
 }
@@ -1,9 +1,64 @@
 #pragma once
 #include <glad/glad.h>
 #include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <GLM/detail/type_vec2.hpp>
 #include <GLM/mat4x4.hpp>
 
+// Uniform name reduced to an FNV-1a hash, computed at compile time for literals. The
+// name itself is only read for the few uniforms whose hashes collide, so it must stay
+// valid for the call the UniformName is passed to.
+struct UniformName
+{
+	unsigned int hash;
+	const char * name;
+
+	constexpr UniformName(const char * name) : hash(Hash(name)), name(name) {}
+	UniformName(const std::string & name) : hash(Hash(name.c_str())), name(name.c_str()) {}
+
+	static constexpr auto Hash(const char * name) -> unsigned int
+	{
+		auto hash = 2166136261u;
+		while (*name != '\0')
+		{
+			hash = (hash ^ static_cast<unsigned char>(*name++)) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+// Pre-resolved uniform of one program, invalid when the program has no such uniform
+struct UniformHandle
+{
+	int location = -1;
+	int slot = -1;
+
+	auto Valid() const -> bool { return slot >= 0; }
+};
+
+// Active uniforms found at link time, with the last value written to each. Shared by
+// all copies of a Shader so shadowed values stay correct when shaders are passed by value.
+struct UniformTable
+{
+	struct Entry
+	{
+		int location;
+		float value[16];
+		bool known;
+	};
+
+	std::vector<Entry> entries;
+	// Slot per name hash, -1 for hashes shared by several names
+	std::unordered_map<unsigned int, int> slots;
+	// Slots of the names behind colliding hashes, found by the full name
+	std::unordered_map<std::string, int> collidingSlots;
+
+	// Skip glUniform calls that would write the value already set
+	bool shadowing = true;
+};
+
 class Shader
 {
 public:
@@ -14,17 +69,45 @@ public:
 	// Activate the shaders
 	auto Use() -> void;
 
+	// Resolve once and keep the handle for per-draw uniforms
+	auto Uniform(UniformName name) const -> UniformHandle;
+
+	// Value shadowing is on by default
+	auto SetShadowing(bool enabled) const -> void;
+
 	// Utility uniform functions
-	auto SetBool(const std::string &name, bool value) const -> void;
-	auto SetInt(const std::string &name, int value) const -> void;
-	auto SetFloat(const std::string &name, float value) const -> void;
-	auto SetVec2(const std::string & name, const glm::vec2 & value) const -> void;
-	auto SetVec2(const std::string & name, float x, float y) const -> void;
-	auto SetVec3(const std::string & name, const glm::vec3 & value) const -> void;
-	auto SetVec3(const std::string & name, float x, float y, float z) const -> void;
-	auto SetVec4(const std::string & name, const glm::vec4 & value) const -> void;
-	auto SetVec4(const std::string & name, float x, float y, float z, float w) -> void;
-	auto SetMat2(const std::string & name, const glm::mat2 & mat) const -> void;
-	auto SetMat3(const std::string & name, const glm::mat3 & mat) const -> void;
-	auto SetMat4(const std::string & name, const glm::mat4 & mat) const -> void;
+	auto SetBool(UniformName name, bool value) const -> void;
+	auto SetInt(UniformName name, int value) const -> void;
+	auto SetFloat(UniformName name, float value) const -> void;
+	auto SetVec2(UniformName name, const glm::vec2 & value) const -> void;
+	auto SetVec2(UniformName name, float x, float y) const -> void;
+	auto SetVec3(UniformName name, const glm::vec3 & value) const -> void;
+	auto SetVec3(UniformName name, float x, float y, float z) const -> void;
+	auto SetVec4(UniformName name, const glm::vec4 & value) const -> void;
+	auto SetVec4(UniformName name, float x, float y, float z, float w) -> void;
+	auto SetMat2(UniformName name, const glm::mat2 & mat) const -> void;
+	auto SetMat3(UniformName name, const glm::mat3 & mat) const -> void;
+	auto SetMat4(UniformName name, const glm::mat4 & mat) const -> void;
+
+	// Handle versions, no lookup at all
+	auto Set(UniformHandle handle, bool value) const -> void;
+	auto Set(UniformHandle handle, int value) const -> void;
+	auto Set(UniformHandle handle, float value) const -> void;
+	auto Set(UniformHandle handle, const glm::vec2 & value) const -> void;
+	auto Set(UniformHandle handle, const glm::vec3 & value) const -> void;
+	auto Set(UniformHandle handle, const glm::vec4 & value) const -> void;
+	auto Set(UniformHandle handle, const glm::mat2 & mat) const -> void;
+	auto Set(UniformHandle handle, const glm::mat3 & mat) const -> void;
+	auto Set(UniformHandle handle, const glm::mat4 & mat) const -> void;
+
+	// Attach a uniform block to a binding point, ignored when the program has no such block
+	auto BindUniformBlock(const std::string & name, unsigned int binding) const -> void;
+
+private:
+	std::shared_ptr<UniformTable> uniforms_;
+
+	auto ReflectUniforms() -> void;
+
+	// Record the value, false when it is unchanged and the glUniform call can be skipped
+	auto Changed(UniformHandle handle, const void * value, size_t size) const -> bool;
 };
@@ -0,0 +1,163 @@
+#include "StaticBatch.h"
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace
+{
+	// Geometry collected for one chunk before its mesh is created
+	struct ChunkBuilder
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::shared_ptr<Material> material;
+		// Layout of the first mesh in the chunk
+		VertexLayout layout;
+		bool doubleSided;
+	};
+
+	// Material (with the double sided flag in bit 0) and the full grid cell coordinates
+	struct CellKey
+	{
+		unsigned int material;
+		glm::ivec3 cell;
+
+		auto operator==(const CellKey & other) const -> bool
+		{
+			return material == other.material && cell == other.cell;
+		}
+	};
+
+	struct CellKeyHash
+	{
+		auto operator()(const CellKey & key) const -> size_t
+		{
+			auto hash = static_cast<size_t>(key.material);
+			hash = hash * 73856093u ^ static_cast<size_t>(static_cast<unsigned int>(key.cell.x));
+			hash = hash * 19349663u ^ static_cast<size_t>(static_cast<unsigned int>(key.cell.y));
+			hash = hash * 83492791u ^ static_cast<size_t>(static_cast<unsigned int>(key.cell.z));
+			return hash;
+		}
+	};
+
+	auto TransformVertex(const Vertex & vertex, const glm::mat4 & matrix, const glm::mat3 & normalMatrix) -> Vertex
+	{
+		auto result = vertex;
+		result.Position = glm::vec3(matrix * glm::vec4(vertex.Position, 1.0f));
+
+		const auto normal = normalMatrix * vertex.Normal;
+		const auto tangent = glm::mat3(matrix) * vertex.Tangent;
+		const auto bitangent = glm::mat3(matrix) * vertex.Bitangent;
+		result.Normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+		result.Tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : tangent;
+		result.Bitangent = glm::length(bitangent) > 0.0f ? glm::normalize(bitangent) : bitangent;
+		return result;
+	}
+}
+
+auto StaticBatch::Build(const std::vector<GameObject*>& objects, const float chunkSize) -> void
+{
+	auto builders = std::vector<ChunkBuilder>();
+	// (material, double sided, cell) -> builder
+	auto cellToBuilder = std::unordered_map<CellKey, unsigned int, CellKeyHash>();
+	// Distinct materials
+	auto materials = std::vector<std::shared_ptr<Material>>();
+
+	auto addMesh = [&](const Mesh& mesh, const glm::mat4& matrix)
+	{
+		auto material = 0u;
+		while (material < materials.size() && materials[material] != mesh.material_) ++material;
+		if (material == materials.size()) materials.push_back(mesh.material_);
+
+		const auto normalMatrix = glm::inverseTranspose(glm::mat3(matrix));
+		auto world = std::vector<Vertex>(mesh.vertices_.size());
+		for (unsigned int i = 0; i < world.size(); ++i)
+		{
+			world[i] = TransformVertex(mesh.vertices_[i], matrix, normalMatrix);
+		}
+
+		// Source vertex -> chunk vertex, per builder this mesh touched
+		auto remap = std::unordered_map<unsigned long long, unsigned int>();
+
+		for (unsigned int i = 0; i + 2 < mesh.indices_.size(); i += 3)
+		{
+			// Triangles go to the cell that holds their centroid
+			const auto centroid = (world[mesh.indices_[i]].Position + world[mesh.indices_[i + 1]].Position + world[mesh.indices_[i + 2]].Position) / 3.0f;
+			const auto cell = glm::ivec3(glm::floor(centroid / chunkSize));
+			const auto key = CellKey{ material << 1 | (mesh.doubleSided_ ? 1u : 0u), cell };
+
+			auto found = cellToBuilder.find(key);
+			if (found == cellToBuilder.end())
+			{
+				found = cellToBuilder.emplace(key, static_cast<unsigned int>(builders.size())).first;
+				builders.push_back(ChunkBuilder{ {}, {}, materials[material], mesh.Layout(), mesh.doubleSided_ });
+			}
+
+			auto& builder = builders[found->second];
+			for (auto corner = 0; corner < 3; ++corner)
+			{
+				const auto source = mesh.indices_[i + corner];
+				const auto remapKey = (static_cast<unsigned long long>(found->second) << 32) | source;
+
+				auto vertex = remap.find(remapKey);
+				if (vertex == remap.end())
+				{
+					vertex = remap.emplace(remapKey, static_cast<unsigned int>(builder.vertices.size())).first;
+					builder.vertices.push_back(world[source]);
+				}
+				builder.indices.push_back(vertex->second);
+			}
+		}
+	};
+
+	for (auto object : objects)
+	{
+		if (!object->isStatic) continue;
+
+		const auto modelMatrix = object->GetModelMatrix();
+		auto& model = object->model;
+
+		if (model.nodes.empty())
+		{
+			for (auto& mesh : model.meshes) addMesh(mesh, modelMatrix);
+			continue;
+		}
+
+		auto globalTransforms = std::vector<glm::mat4>(model.nodes.size());
+		for (unsigned int n = 0; n < model.nodes.size(); ++n)
+		{
+			const auto& node = model.nodes[n];
+			globalTransforms[n] = (node.parent < 0 ? modelMatrix : globalTransforms[node.parent]) * node.localTransform;
+
+			for (auto m = node.firstMesh; m < node.firstMesh + node.meshCount; ++m)
+			{
+				addMesh(model.meshes[m], globalTransforms[n]);
+			}
+		}
+	}
+
+	chunks.clear();
+	chunks.reserve(builders.size());
+	for (auto& builder : builders)
+	{
+		auto mesh = Mesh(std::move(builder.vertices), std::move(builder.indices), builder.material, builder.layout);
+		mesh.doubleSided_ = builder.doubleSided;
+		const auto boundsMin = mesh.boundsMin_;
+		const auto boundsMax = mesh.boundsMax_;
+		chunks.push_back(StaticChunk{ std::move(mesh), boundsMin, boundsMax });
+	}
+}
+
+auto StaticBatch::Draw(Shader shaderProgram, FrustumG& frustum, const glm::vec3& viewPosition) -> void
+{
+	visibleChunks = 0;
+	const auto identity = glm::mat4(1.0f);
+
+	for (auto& chunk : chunks)
+	{
+		if (frustum.boxInFrustum(chunk.boundsMin, chunk.boundsMax) == FrustumG::OUTSIDE) continue;
+
+		chunk.mesh.Draw(shaderProgram, frustum, identity, viewPosition);
+		++visibleChunks;
+	}
+}
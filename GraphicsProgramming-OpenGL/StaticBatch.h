@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "GameObject.h"
+#include "FrustumG.h"
+
+// Default edge length of a static batch chunk in world units
+const float STATIC_CHUNK_SIZE = 16.0f;
+
+// World space geometry of one material inside one chunk of the world grid
+struct StaticChunk
+{
+	Mesh mesh;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Geometry of static GameObjects pre-transformed to world space and merged per material
+// and grid cell, so the draw count follows materials x chunks instead of objects. Meant
+// for drivers without multi draw indirect, the objects themselves are no longer drawn.
+class StaticBatch
+{
+public:
+	std::vector<StaticChunk> chunks;
+
+	// Merge the objects marked isStatic, run once when the scene is loaded
+	auto Build(const std::vector<GameObject *> & objects, float chunkSize = STATIC_CHUNK_SIZE) -> void;
+
+	// Draw the chunks inside the frustum, meshlets are culled as well
+	auto Draw(Shader shaderProgram, FrustumG & frustum, const glm::vec3 & viewPosition) -> void;
+
+	// Number of chunks drawn by the last Draw
+	unsigned int visibleChunks = 0;
+};
@@ -0,0 +1,120 @@
+#include "StreamBuffer.h"
+#include <cstring>
+#include <iostream>
+#include "GLExtensions.h"
+
+StreamBuffer::StreamBuffer(const size_t frameSize, const unsigned int frames) :
+	frameSize_(frameSize), frames_(frames), fences_(frames, nullptr), head_(0)
+{
+	const auto size = static_cast<GLsizeiptr>(frameSize_ * frames_);
+
+	auto alignment = GLint(0);
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0) uniformAlignment_ = static_cast<size_t>(alignment);
+
+	glGenBuffers(1, &buffer_);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+	if (GLExtensions::bufferStorage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLExtensions::BufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+		mapped_ = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+		persistent_ = mapped_ != nullptr;
+	}
+
+	if (!persistent_)
+	{
+		// Plain buffer, written a range at a time by Flush
+		if (GLExtensions::bufferStorage)
+		{
+			std::cout << "Failed to map the stream buffer, falling back to uploads" << std::endl;
+			glDeleteBuffers(1, &buffer_);
+			glGenBuffers(1, &buffer_);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		}
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		staging_.resize(frameSize_ * frames_);
+		mapped_ = staging_.data();
+	}
+
+	// Start inside the last partition so the first BeginFrame moves to partition 0
+	frame_ = frames_ - 1;
+	head_ = frame_ * frameSize_;
+	end_ = (frame_ + 1) * frameSize_;
+}
+
+auto StreamBuffer::Shared() -> StreamBuffer &
+{
+	static StreamBuffer stream(STREAM_FRAME_SIZE, STREAM_FRAMES);
+	return stream;
+}
+
+auto StreamBuffer::BeginFrame() -> void
+{
+	frame_ = (frame_ + 1) % frames_;
+
+	// Only blocks when the CPU is a whole ring ahead of the GPU
+	if (fences_[frame_] != nullptr)
+	{
+		while (glClientWaitSync(fences_[frame_], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fences_[frame_]);
+		fences_[frame_] = nullptr;
+	}
+
+	head_.store(frame_ * frameSize_, std::memory_order_relaxed);
+	end_ = (frame_ + 1) * frameSize_;
+}
+
+auto StreamBuffer::EndFrame() -> void
+{
+	if (fences_[frame_] != nullptr) glDeleteSync(fences_[frame_]);
+	fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+auto StreamBuffer::Allocate(const size_t size, const size_t alignment) -> StreamAllocation
+{
+	auto current = head_.load(std::memory_order_relaxed);
+	auto offset = size_t(0);
+	do
+	{
+		offset = alignment > 1 ? (current + alignment - 1) / alignment * alignment : current;
+		if (offset + size > end_) return StreamAllocation{ nullptr, 0, 0 };
+	}
+	while (!head_.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+	return StreamAllocation{ mapped_ + offset, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size) };
+}
+
+auto StreamBuffer::Flush(const StreamAllocation& allocation) -> void
+{
+	if (persistent_ || !allocation.Valid()) return;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+}
+
+auto StreamBuffer::Write(const void* data, const size_t size, const size_t alignment) -> StreamAllocation
+{
+	const auto allocation = Allocate(size, alignment);
+	if (!allocation.Valid()) return allocation;
+
+	std::memcpy(allocation.data, data, size);
+	Flush(allocation);
+	return allocation;
+}
+
+auto StreamBuffer::Buffer() const -> unsigned int
+{
+	return buffer_;
+}
+
+auto StreamBuffer::Persistent() const -> bool
+{
+	return persistent_;
+}
+
+auto StreamBuffer::UniformAlignment() const -> size_t
+{
+	return uniformAlignment_;
+}
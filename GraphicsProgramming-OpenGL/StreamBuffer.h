@@ -0,0 +1,71 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <vector>
+
+// Frames the CPU may run ahead of the GPU, each with its own partition of the buffer
+const unsigned int STREAM_FRAMES = 3;
+// Bytes per partition, sized for the busiest frame
+const size_t STREAM_FRAME_SIZE = 8 << 20;
+
+// Bytes written this frame, data is nullptr when the partition is full
+struct StreamAllocation
+{
+	void * data;
+	GLintptr offset;
+	GLsizeiptr size;
+
+	auto Valid() const -> bool { return data != nullptr; }
+};
+
+// Ring of per-frame partitions in one buffer for data rewritten every frame: instance data,
+// indirect commands, per-frame uniform blocks. With buffer storage the buffer stays mapped
+// persistent and coherent, writes land in GPU visible memory directly and nothing is ever
+// orphaned. A fence per partition keeps the CPU from overwriting a partition the GPU still
+// reads. Allocation is a lock-free bump, so worker threads can write too.
+// Without buffer storage writes go to a CPU copy of the buffer and Flush uploads them.
+class StreamBuffer
+{
+public:
+	StreamBuffer(size_t frameSize, unsigned int frames);
+
+	// Move to the next partition, waiting for the GPU to release it
+	auto BeginFrame() -> void;
+	// Fence everything issued with this frame's partition
+	auto EndFrame() -> void;
+
+	// Any thread, between BeginFrame and EndFrame. alignment need not be a power of two.
+	auto Allocate(size_t size, size_t alignment) -> StreamAllocation;
+
+	// Make the allocation visible to GL, a no-op when persistently mapped. GL thread only,
+	// after the writes and before the draw that reads them.
+	auto Flush(const StreamAllocation & allocation) -> void;
+
+	// Allocate, copy and flush in one, GL thread only
+	auto Write(const void * data, size_t size, size_t alignment) -> StreamAllocation;
+
+	auto Buffer() const -> unsigned int;
+	auto Persistent() const -> bool;
+	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for uniform blocks bound from the stream
+	auto UniformAlignment() const -> size_t;
+
+	static auto Shared() -> StreamBuffer &;
+
+private:
+	unsigned int buffer_ = 0;
+	unsigned char * mapped_ = nullptr;
+	bool persistent_ = false;
+	size_t uniformAlignment_ = 256;
+
+	size_t frameSize_;
+	unsigned int frames_;
+	unsigned int frame_ = 0;
+	std::vector<GLsync> fences_;
+
+	// Next free byte and end of the current partition
+	std::atomic<size_t> head_;
+	size_t end_ = 0;
+
+	// CPU copy of the buffer without buffer storage
+	std::vector<unsigned char> staging_;
+};
@@ -0,0 +1,159 @@
+#include "Terrain.h"
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+// The nodes are filled in while the indices are built, so the mesh is only created once
+// both exist
+Terrain::Terrain(std::vector<Vertex> vertices, const int wRes, const int lRes, std::vector<Texture> textures, const int chunkSize)
+{
+	auto indices = BuildIndices(vertices, wRes, lRes, chunkSize);
+	mesh = Mesh(std::move(vertices), std::move(indices), std::move(textures));
+}
+
+// Lay the chunks out in quadtree order, filling in the nodes on the way
+auto Terrain::BuildIndices(const std::vector<Vertex>& vertices, const int wRes, const int lRes, const int chunkSize) -> std::vector<unsigned int>
+{
+	auto indices = std::vector<unsigned int>();
+	indices.reserve((wRes - 1) * (lRes - 1) * 6);
+
+	nodes.clear();
+	if (wRes < 2 || lRes < 2) return indices;
+
+	const auto chunksX = (wRes - 2) / chunkSize + 1;
+	const auto chunksZ = (lRes - 2) / chunkSize + 1;
+	BuildNode(0, 0, chunksX, chunksZ, vertices, wRes, lRes, chunkSize, indices);
+
+	return indices;
+}
+
+// Build the node covering chunks [x0, x1) x [z0, z1), returns its index
+auto Terrain::BuildNode(const int x0, const int z0, const int x1, const int z1, const std::vector<Vertex>& vertices,
+	const int wRes, const int lRes, const int chunkSize, std::vector<unsigned int>& indices) -> int
+{
+	const auto index = static_cast<int>(nodes.size());
+	nodes.push_back(TerrainNode());
+	nodes[index].firstIndex = static_cast<unsigned int>(indices.size());
+	nodes[index].chunkCount = 1;
+	for (auto& child : nodes[index].children) child = -1;
+
+	if (x1 - x0 == 1 && z1 - z0 == 1)
+	{
+		// Chunk -----------------------------------------------------------------------------------
+		const auto quadX0 = x0 * chunkSize, quadX1 = glm::min(quadX0 + chunkSize, wRes - 1);
+		const auto quadZ0 = z0 * chunkSize, quadZ1 = glm::min(quadZ0 + chunkSize, lRes - 1);
+
+		auto min = vertices[quadZ0 * wRes + quadX0].Position;
+		auto max = min;
+		for (auto z = quadZ0; z <= quadZ1; ++z) for (auto x = quadX0; x <= quadX1; ++x)
+		{
+			min = glm::min(min, vertices[z * wRes + x].Position);
+			max = glm::max(max, vertices[z * wRes + x].Position);
+		}
+		nodes[index].boundsMin = min;
+		nodes[index].boundsMax = max;
+
+		for (auto z = quadZ0; z < quadZ1; ++z) for (auto x = quadX0; x < quadX1; ++x)
+		{
+			const auto i = static_cast<unsigned int>(z * wRes + x);
+			indices.push_back(i);
+			indices.push_back(i + wRes);
+			indices.push_back(i + wRes + 1);
+			indices.push_back(i);
+			indices.push_back(i + wRes + 1);
+			indices.push_back(i + 1);
+		}
+	}
+	else
+	{
+		// Split into up to four children ------------------------------------------------------------
+		const auto midX = x1 - x0 > 1 ? (x0 + x1) / 2 : x1;
+		const auto midZ = z1 - z0 > 1 ? (z0 + z1) / 2 : z1;
+		const int quadrants[4][4] = {
+			{ x0, z0, midX, midZ },
+			{ midX, z0, x1, midZ },
+			{ x0, midZ, midX, z1 },
+			{ midX, midZ, x1, z1 }
+		};
+
+		auto first = true;
+		nodes[index].chunkCount = 0;
+		for (auto q = 0; q < 4; ++q)
+		{
+			const auto& r = quadrants[q];
+			if (r[0] >= r[2] || r[1] >= r[3]) continue;
+
+			const auto child = BuildNode(r[0], r[1], r[2], r[3], vertices, wRes, lRes, chunkSize, indices);
+			nodes[index].children[q] = child;
+			nodes[index].chunkCount += nodes[child].chunkCount;
+			nodes[index].boundsMin = first ? nodes[child].boundsMin : glm::min(nodes[index].boundsMin, nodes[child].boundsMin);
+			nodes[index].boundsMax = first ? nodes[child].boundsMax : glm::max(nodes[index].boundsMax, nodes[child].boundsMax);
+			first = false;
+		}
+	}
+
+	nodes[index].indexCount = static_cast<unsigned int>(indices.size()) - nodes[index].firstIndex;
+	return index;
+}
+
+auto Terrain::Draw(Shader shaderProgram, const glm::mat4& modelMatrix) -> void
+{
+	mesh.Draw(shaderProgram, modelMatrix);
+}
+
+// Draw only the chunks whose bounds are inside the frustum
+auto Terrain::Draw(Shader shaderProgram, FrustumG& frustum, const glm::mat4& modelMatrix) -> void
+{
+	drawCounts_.clear();
+	drawOffsets_.clear();
+	visibleChunks = 0;
+
+	if (!nodes.empty())
+	{
+		CullNode(0, frustum, modelMatrix);
+	}
+
+	mesh.DrawRanges(shaderProgram, modelMatrix, drawCounts_, drawOffsets_);
+}
+
+auto Terrain::CullNode(const int index, FrustumG& frustum, const glm::mat4& modelMatrix) -> void
+{
+	const auto& node = nodes[index];
+	if (node.indexCount == 0) return;
+
+	glm::vec3 min, max;
+	TransformBounds(modelMatrix, node.boundsMin, node.boundsMax, min, max);
+
+	const auto result = frustum.boxInFrustum(min, max);
+	if (result == FrustumG::OUTSIDE) return;
+
+	const auto leaf = node.children[0] < 0 && node.children[1] < 0 && node.children[2] < 0 && node.children[3] < 0;
+
+	// Fully visible subtrees are one contiguous range
+	if (result == FrustumG::INSIDE || leaf)
+	{
+		AddRange(node);
+		return;
+	}
+
+	for (auto child : node.children)
+	{
+		if (child >= 0) CullNode(child, frustum, modelMatrix);
+	}
+}
+
+auto Terrain::AddRange(const TerrainNode& node) -> void
+{
+	visibleChunks += node.chunkCount;
+
+	const auto offset = reinterpret_cast<const void *>(node.firstIndex * sizeof(unsigned int));
+
+	// Merge with the previous range when adjacent in the index buffer
+	if (!drawCounts_.empty() && static_cast<const char *>(drawOffsets_.back()) + drawCounts_.back() * sizeof(unsigned int) == offset)
+	{
+		drawCounts_.back() += node.indexCount;
+		return;
+	}
+
+	drawCounts_.push_back(node.indexCount);
+	drawOffsets_.push_back(offset);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Mesh.h"
+#include "FrustumG.h"
+
+// Terrain chunk size in quads
+const int TERRAIN_CHUNK_SIZE = 32;
+
+// Node of the terrain's min/max height quadtree. Chunks are written to the index buffer
+// in tree order, so every node covers one contiguous index range.
+struct TerrainNode
+{
+	// Tight bounds in terrain space, y is the min/max height below the node
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	// Child nodes, -1 where there is none (all -1 for a chunk)
+	int children[4];
+
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int chunkCount;
+};
+
+// Heightfield split into chunks that are culled through a min/max quadtree
+class Terrain
+{
+public:
+	// Quadtree nodes, nodes[0] is the root
+	std::vector<TerrainNode> nodes;
+	Mesh mesh;
+
+	// Number of chunks drawn by the last culled draw
+	unsigned int visibleChunks = 0;
+
+	// vertices is a wRes x lRes grid in row (z) major order
+	Terrain(std::vector<Vertex> vertices, int wRes, int lRes, std::vector<Texture> textures, int chunkSize = TERRAIN_CHUNK_SIZE);
+
+	auto Draw(Shader shaderProgram, const glm::mat4 & modelMatrix) -> void;
+	auto Draw(Shader shaderProgram, FrustumG & frustum, const glm::mat4 & modelMatrix) -> void;
+
+private:
+	std::vector<GLsizei> drawCounts_;
+	std::vector<const void *> drawOffsets_;
+
+	auto BuildIndices(const std::vector<Vertex> & vertices, int wRes, int lRes, int chunkSize) -> std::vector<unsigned int>;
+	auto BuildNode(int x0, int z0, int x1, int z1, const std::vector<Vertex> & vertices, int wRes, int lRes, int chunkSize, std::vector<unsigned int> & indices) -> int;
+	auto CullNode(int index, FrustumG & frustum, const glm::mat4 & modelMatrix) -> void;
+	auto AddRange(const TerrainNode & node) -> void;
+};
@@ -0,0 +1,72 @@
+#include "TextureArrays.h"
+#include <glad/glad.h>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include "GLState.h"
+
+auto TextureArrays::Build(const std::vector<unsigned int>& textures, const unsigned int unit) -> void
+{
+	// Group by size --------------------------------------------------------------------------------
+	auto bySize = std::map<std::pair<int, int>, std::vector<unsigned int>>();
+	for (auto texture : textures)
+	{
+		if (texture == 0 || layers_.count(texture) > 0) continue;
+
+		GLState::BindTexture(0, texture);
+		auto width = 0;
+		auto height = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		if (width == 0 || height == 0) continue;
+
+		auto& group = bySize[std::make_pair(width, height)];
+		if (std::find(group.begin(), group.end(), texture) == group.end()) group.push_back(texture);
+	}
+
+	// Copy each group into its array through a CPU side buffer (GL 3.3 has no image copies) --------
+	auto pixels = std::vector<unsigned char>();
+	for (auto& group : bySize)
+	{
+		const auto width = group.first.first;
+		const auto height = group.first.second;
+		const auto& members = group.second;
+
+		unsigned int array;
+		glGenTextures(1, &array);
+		GLState::BindTexture(unit, array, GL_TEXTURE_2D_ARRAY);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, static_cast<GLsizei>(members.size()), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		pixels.resize(static_cast<size_t>(width) * height * 4);
+		for (unsigned int layer = 0; layer < members.size(); ++layer)
+		{
+			// Sources are read on unit 0, the array is written on its own unit
+			GLState::BindTexture(0, members[layer]);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			GLState::ActiveTexture(unit);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+			layers_[members[layer]] = TextureLayer{ array, static_cast<int>(layer) };
+		}
+
+		// Same sampling as Model::TextureFromFile
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		arrays_.push_back(array);
+	}
+}
+
+auto TextureArrays::Find(const unsigned int texture) const -> TextureLayer
+{
+	const auto found = layers_.find(texture);
+	return found != layers_.end() ? found->second : TextureLayer{ 0, -1 };
+}
+
+auto TextureArrays::ArrayCount() const -> unsigned int
+{
+	return static_cast<unsigned int>(arrays_.size());
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+// Where a packed texture ended up
+struct TextureLayer
+{
+	unsigned int array;
+	int layer;
+};
+
+// Packs 2D textures into GL_TEXTURE_2D_ARRAYs, one array per texture size, so materials
+// whose textures share sizes also share bindings and only differ in layer indices.
+// The source textures are left alone.
+class TextureArrays
+{
+public:
+	// Copy every texture into the array for its size, run once after loading. The arrays
+	// are bound on unit, which must not be 0 as the source textures are read there.
+	auto Build(const std::vector<unsigned int> & textures, unsigned int unit) -> void;
+
+	// {0, -1} when the texture was not packed
+	auto Find(unsigned int texture) const -> TextureLayer;
+
+	auto ArrayCount() const -> unsigned int;
+
+private:
+	std::vector<unsigned int> arrays_;
+	std::unordered_map<unsigned int, TextureLayer> layers_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+
+// Lock-free handoff between one writer and one reader. The writer fills Back and
+// Publishes it, the reader Acquires the newest published slot and reads Front. Neither
+// side ever waits: a slot the reader has not picked up yet is replaced by the next
+// Publish, and the reader keeps its Front until something newer arrives.
+template <typename T>
+class TripleBuffer
+{
+public:
+	auto Back() -> T & { return slots_[back_]; }
+	auto Front() const -> const T & { return slots_[front_]; }
+
+	// Writer side, Back is a different slot afterwards
+	auto Publish() -> void
+	{
+		back_ = ready_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Reader side, false when nothing was published since the last Acquire
+	auto Acquire() -> bool
+	{
+		if ((ready_.load(std::memory_order_acquire) & FRESH_BIT) == 0) return false;
+
+		front_ = ready_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+private:
+	static const unsigned int INDEX_MASK = 0x3;
+	static const unsigned int FRESH_BIT = 0x4;
+
+	T slots_[3];
+	unsigned int back_ = 0;
+	unsigned int front_ = 1;
+
+	// Index of the slot between the two sides, with FRESH_BIT until the reader takes it
+	std::atomic<unsigned int> ready_{ 2 };
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include "StreamBuffer.h"
+
+// Binding points shared by every program, Shader binds its blocks to these after linking
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+const unsigned int LIGHT_UNIFORM_BINDING = 1;
+const unsigned int MATERIAL_UNIFORM_BINDING = 2;
+
+// Mirrors of the std140 blocks in the shaders. vec3s are padded to 16 bytes, a float
+// directly after a vec3 shares its last slot.
+
+// layout (std140) uniform FrameData
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 lightSpaceMatrix;
+	glm::vec3 viewPosition;
+	float time;
+};
+
+// layout (std140) uniform LightData, w unused
+struct LightUniforms
+{
+	glm::vec4 position;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+};
+
+// layout (std140) uniform MaterialData
+struct MaterialUniforms
+{
+	float shininess;
+	float emissionIntensity;
+	// Sample the diffuse, specular and emission layers of the texture arrays instead
+	int textureArrays;
+	int padding;
+	int layers[4];
+};
+
+// Uniform buffer holding one T, bound to a fixed binding point for its whole life
+template <typename T>
+class UniformBuffer
+{
+public:
+	explicit UniformBuffer(const unsigned int binding) : binding_(binding)
+	{
+		glGenBuffers(1, &UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding_, UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	~UniformBuffer()
+	{
+		glDeleteBuffers(1, &UBO);
+	}
+
+	UniformBuffer(const UniformBuffer &) = delete;
+	auto operator=(const UniformBuffer &) -> UniformBuffer & = delete;
+
+	// One write of the whole block
+	auto Update(const T & data) -> void
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// Rebind to the binding point, for when another buffer has been bound there
+	auto Bind() const -> void
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding_, UBO);
+	}
+
+private:
+	unsigned int UBO = 0;
+	unsigned int binding_;
+};
+
+// Uniform block rewritten every frame. Each Update writes a fresh copy into the shared
+// StreamBuffer and binds that range, so the GPU never waits on a buffer it is reading.
+template <typename T>
+class StreamedUniformBuffer
+{
+public:
+	explicit StreamedUniformBuffer(const unsigned int binding) : binding_(binding)
+	{
+	}
+
+	// Once per frame, before the first draw that reads the block
+	auto Update(const T & data) -> void
+	{
+		auto& stream = StreamBuffer::Shared();
+		range_ = stream.Write(&data, sizeof(T), stream.UniformAlignment());
+		Bind();
+	}
+
+	auto Bind() const -> void
+	{
+		if (!range_.Valid()) return;
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding_, StreamBuffer::Shared().Buffer(), range_.offset, range_.size);
+	}
+
+private:
+	unsigned int binding_;
+	StreamAllocation range_ = StreamAllocation{ nullptr, 0, 0 };
+};
+
+static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms must match the std140 FrameData block");
+static_assert(sizeof(LightUniforms) == 64, "LightUniforms must match the std140 LightData block");
+static_assert(sizeof(MaterialUniforms) == 32, "MaterialUniforms must match the std140 MaterialData block");
@@ -0,0 +1,163 @@
+#include "VertexFormat.h"
+#include <algorithm>
+#include "GLExtensions.h"
+#include "GLState.h"
+
+namespace
+{
+	// Matches no buffer, so the next Bind attaches again
+	const unsigned int DETACHED = ~0u;
+}
+
+VertexFormat::VertexFormat(const unsigned int vertexStride, const unsigned int instanceStride, std::vector<VertexAttribute> attributes) :
+	vertexStride_(vertexStride), instanceStride_(instanceStride), attributes_(std::move(attributes)), attached_{ DETACHED, DETACHED, DETACHED, 0 }
+{
+}
+
+auto VertexFormat::Bind(const VertexBuffers& buffers) -> void
+{
+	if (!GLExtensions::vertexAttribBinding)
+	{
+		const auto found = Find(buffers);
+		if (found == arrays_.end())
+		{
+			arrays_.emplace_back(buffers, Create(buffers));
+			return;
+		}
+
+		GLState::BindVertexArray(found->second);
+		if (found->first.instanceOffset != buffers.instanceOffset)
+		{
+			PointInstanceAttributes(buffers);
+			found->first.instanceOffset = buffers.instanceOffset;
+		}
+		return;
+	}
+
+	if (sharedArray_ == 0) CreateShared();
+	GLState::BindVertexArray(sharedArray_);
+
+	// Swap only the buffers that differ -----------------------------------------------------------
+	if (buffers.vertex != attached_.vertex)
+	{
+		GLExtensions::BindVertexBuffer(BINDING_VERTEX, buffers.vertex, 0, vertexStride_);
+		++GLState::counters.issued;
+	}
+	else ++GLState::counters.skipped;
+
+	if (buffers.instance != attached_.instance || buffers.instanceOffset != attached_.instanceOffset)
+	{
+		GLExtensions::BindVertexBuffer(BINDING_INSTANCE, buffers.instance, buffers.instanceOffset, instanceStride_);
+		++GLState::counters.issued;
+	}
+	else ++GLState::counters.skipped;
+
+	if (buffers.element != attached_.element)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.element);
+		++GLState::counters.issued;
+	}
+	else ++GLState::counters.skipped;
+
+	attached_ = buffers;
+}
+
+auto VertexFormat::Release(const VertexBuffers& buffers) -> void
+{
+	if (buffers.vertex == attached_.vertex || buffers.element == attached_.element)
+	{
+		attached_ = VertexBuffers{ DETACHED, DETACHED, DETACHED, 0 };
+	}
+
+	const auto found = Find(buffers);
+	if (found == arrays_.end()) return;
+
+	// Unbind first, deleting the bound VAO would leave the cache pointing at a dead name
+	GLState::BindVertexArray(0);
+	glDeleteVertexArrays(1, &found->second);
+	arrays_.erase(found);
+}
+
+// The VAO for a vertex and element buffer, whatever instance data it points at
+auto VertexFormat::Find(const VertexBuffers& buffers) -> std::vector<std::pair<VertexBuffers, unsigned int>>::iterator
+{
+	return std::find_if(arrays_.begin(), arrays_.end(), [&buffers](const std::pair<VertexBuffers, unsigned int>& entry)
+	{
+		return entry.first.vertex == buffers.vertex && entry.first.instance == buffers.instance && entry.first.element == buffers.element;
+	});
+}
+
+// Attribute formats only, buffers are attached by Bind
+auto VertexFormat::CreateShared() -> void
+{
+	glGenVertexArrays(1, &sharedArray_);
+	GLState::BindVertexArray(sharedArray_);
+
+	for (auto& attribute : attributes_)
+	{
+		glEnableVertexAttribArray(attribute.location);
+		if (attribute.integer)
+		{
+			GLExtensions::VertexAttribIFormat(attribute.location, attribute.size, attribute.type, attribute.offset);
+		}
+		else
+		{
+			GLExtensions::VertexAttribFormat(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.offset);
+		}
+		GLExtensions::VertexAttribBinding(attribute.location, attribute.binding);
+	}
+	GLExtensions::VertexBindingDivisor(BINDING_INSTANCE, 1);
+
+	attached_ = VertexBuffers{ DETACHED, DETACHED, DETACHED, 0 };
+}
+
+auto VertexFormat::Create(const VertexBuffers& buffers) -> unsigned int
+{
+	unsigned int vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	GLState::BindVertexArray(vertexArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.element);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vertex);
+
+	for (auto& attribute : attributes_)
+	{
+		if (attribute.binding != BINDING_VERTEX) continue;
+
+		const auto offset = reinterpret_cast<void *>(static_cast<size_t>(attribute.offset));
+		glEnableVertexAttribArray(attribute.location);
+		if (attribute.integer)
+		{
+			glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, vertexStride_, offset);
+		}
+		else
+		{
+			glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, vertexStride_, offset);
+		}
+	}
+
+	PointInstanceAttributes(buffers);
+	return vertexArray;
+}
+
+// Instance attributes of the bound VAO, the offset is baked into the pointers
+auto VertexFormat::PointInstanceAttributes(const VertexBuffers& buffers) -> void
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.instance);
+
+	for (auto& attribute : attributes_)
+	{
+		if (attribute.binding != BINDING_INSTANCE) continue;
+
+		const auto offset = reinterpret_cast<void *>(static_cast<size_t>(buffers.instanceOffset + attribute.offset));
+		glEnableVertexAttribArray(attribute.location);
+		if (attribute.integer)
+		{
+			glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, instanceStride_, offset);
+		}
+		else
+		{
+			glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, instanceStride_, offset);
+		}
+		glVertexAttribDivisor(attribute.location, 1);
+	}
+}
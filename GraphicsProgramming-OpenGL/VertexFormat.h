@@ -0,0 +1,68 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <utility>
+
+// Buffer binding points of a vertex format
+enum Vertex_Binding
+{
+	BINDING_VERTEX = 0,
+	BINDING_INSTANCE = 1
+};
+
+struct VertexAttribute
+{
+	unsigned int location;
+	int size;
+	GLenum type;
+	bool normalized;
+	// Read as an int in the shader, not converted to float
+	bool integer;
+	unsigned int offset;
+	Vertex_Binding binding;
+};
+
+// The buffers a draw with a vertex format reads from
+struct VertexBuffers
+{
+	unsigned int vertex;
+	unsigned int instance;
+	unsigned int element;
+	// Byte offset of the first instance, instance data is streamed
+	GLintptr instanceOffset;
+};
+
+// Attribute layout of a vertex stream and an instance stream, see VertexLayout. With vertex
+// attrib binding each format has one VAO shared by every set of buffers in that layout, so
+// switching between them is two glBindVertexBuffer and an element buffer bind, skipped when
+// the buffers are already attached. Without it each set of buffers gets its own VAO, whose
+// instance attributes are pointed again whenever the streamed instance offset moves.
+class VertexFormat
+{
+public:
+	VertexFormat(unsigned int vertexStride, unsigned int instanceStride, std::vector<VertexAttribute> attributes);
+
+	// Bind the VAO for the buffers, attaching them when needed
+	auto Bind(const VertexBuffers & buffers) -> void;
+
+	// Forget a set of buffers before they are deleted or replaced
+	auto Release(const VertexBuffers & buffers) -> void;
+
+private:
+	unsigned int vertexStride_;
+	unsigned int instanceStride_;
+	std::vector<VertexAttribute> attributes_;
+
+	// The shared VAO and the buffers currently attached to it
+	unsigned int sharedArray_ = 0;
+	VertexBuffers attached_;
+
+	// One VAO per set of buffers without vertex attrib binding, with the instance offset
+	// its attributes currently point at
+	std::vector<std::pair<VertexBuffers, unsigned int>> arrays_;
+
+	auto CreateShared() -> void;
+	auto Create(const VertexBuffers & buffers) -> unsigned int;
+	auto PointInstanceAttributes(const VertexBuffers & buffers) -> void;
+	auto Find(const VertexBuffers & buffers) -> std::vector<std::pair<VertexBuffers, unsigned int>>::iterator;
+};
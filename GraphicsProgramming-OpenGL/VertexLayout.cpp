@@ -0,0 +1,242 @@
+#include "VertexLayout.h"
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include "Mesh.h"
+
+namespace
+{
+	auto PositionBytes(const Position_Encoding encoding) -> unsigned int
+	{
+		return encoding == POSITION_UNORM16 ? 4 * sizeof(glm::uint16) : sizeof(glm::vec3);
+	}
+
+	auto NormalBytes(const Normal_Encoding encoding) -> unsigned int
+	{
+		switch (encoding)
+		{
+		case NORMAL_FLOAT: return sizeof(glm::vec3);
+		case NORMAL_INT_2_10_10_10: return sizeof(glm::uint32);
+		case NORMAL_OCTAHEDRAL: return 2 * sizeof(glm::uint16);
+		default: return 0;
+		}
+	}
+
+	auto TexCoordBytes(const TexCoord_Encoding encoding) -> unsigned int
+	{
+		switch (encoding)
+		{
+		case TEXCOORD_FLOAT: return sizeof(glm::vec2);
+		case TEXCOORD_HALF:
+		case TEXCOORD_UNORM16: return 2 * sizeof(glm::uint16);
+		default: return 0;
+		}
+	}
+
+	auto TangentBytes(const Tangent_Encoding encoding) -> unsigned int
+	{
+		return encoding == TANGENT_FLOAT ? 2 * sizeof(glm::vec3) : 0;
+	}
+
+	// Instance transform, one attribute per column, optionally with the params and material
+	auto AppendInstanceAttributes(std::vector<VertexAttribute>& attributes, const bool transformOnly) -> void
+	{
+		for (unsigned int column = 0; column < 4; ++column)
+		{
+			attributes.push_back({ 5 + column, 4, GL_FLOAT, false, false, static_cast<unsigned int>(offsetof(InstanceData, Transform) + column * sizeof(glm::vec4)), BINDING_INSTANCE });
+		}
+		if (transformOnly) return;
+
+		attributes.push_back({ 9, 4, GL_FLOAT, false, false, offsetof(InstanceData, Params), BINDING_INSTANCE });
+		attributes.push_back({ 10, 1, GL_INT, false, true, offsetof(InstanceData, MaterialIndex), BINDING_INSTANCE });
+	}
+
+	auto PositionAttribute(const Position_Encoding encoding) -> VertexAttribute
+	{
+		if (encoding == POSITION_UNORM16) return { 0, 3, GL_UNSIGNED_SHORT, true, false, 0, BINDING_VERTEX };
+		return { 0, 3, GL_FLOAT, false, false, 0, BINDING_VERTEX };
+	}
+
+	// Bounds mapped to [0, 1], flat axes stay at 0
+	auto Quantise(const glm::vec3& position, const glm::vec3& boundsMin, const glm::vec3& boundsMax) -> glm::vec3
+	{
+		const auto extent = boundsMax - boundsMin;
+		auto result = glm::vec3(0);
+		for (auto axis = 0; axis < 3; ++axis)
+		{
+			if (extent[axis] > 0.0f) result[axis] = glm::clamp((position[axis] - boundsMin[axis]) / extent[axis], 0.0f, 1.0f);
+		}
+		return result;
+	}
+
+	auto WritePosition(const Position_Encoding encoding, const glm::vec3& position, const glm::vec3& boundsMin, const glm::vec3& boundsMax, unsigned char* out) -> void
+	{
+		if (encoding == POSITION_FLOAT)
+		{
+			memcpy(out, &position, sizeof(glm::vec3));
+			return;
+		}
+
+		const auto unit = Quantise(position, boundsMin, boundsMax);
+		const glm::uint16 packed[4] = { glm::packUnorm1x16(unit.x), glm::packUnorm1x16(unit.y), glm::packUnorm1x16(unit.z), 0 };
+		memcpy(out, packed, sizeof(packed));
+	}
+
+	// Project onto the octahedron and unfold the lower half, see the lighting vertex shaders
+	auto OctahedralEncode(const glm::vec3& normal) -> glm::vec2
+	{
+		const auto sum = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		if (sum <= 0.0f) return glm::vec2(0);
+
+		auto result = glm::vec2(normal) / sum;
+		if (normal.z < 0.0f)
+		{
+			const auto sign = glm::vec2(result.x >= 0.0f ? 1.0f : -1.0f, result.y >= 0.0f ? 1.0f : -1.0f);
+			result = (1.0f - glm::abs(glm::vec2(result.y, result.x))) * sign;
+		}
+		return result;
+	}
+}
+
+auto VertexLayout::Stride() const -> unsigned int
+{
+	return PositionBytes(positions) + NormalBytes(normals) + TexCoordBytes(texCoords) + TangentBytes(tangents);
+}
+
+auto VertexLayout::PositionStride() const -> unsigned int
+{
+	return PositionBytes(positions);
+}
+
+auto VertexLayout::Attributes() const -> std::vector<VertexAttribute>
+{
+	auto attributes = std::vector<VertexAttribute>{ PositionAttribute(positions) };
+	auto offset = PositionBytes(positions);
+
+	switch (normals)
+	{
+	case NORMAL_FLOAT: attributes.push_back({ 1, 3, GL_FLOAT, false, false, offset, BINDING_VERTEX }); break;
+	case NORMAL_INT_2_10_10_10: attributes.push_back({ 1, 4, GL_INT_2_10_10_10_REV, true, false, offset, BINDING_VERTEX }); break;
+	case NORMAL_OCTAHEDRAL: attributes.push_back({ 1, 2, GL_SHORT, true, false, offset, BINDING_VERTEX }); break;
+	default: break;
+	}
+	offset += NormalBytes(normals);
+
+	switch (texCoords)
+	{
+	case TEXCOORD_FLOAT: attributes.push_back({ 2, 2, GL_FLOAT, false, false, offset, BINDING_VERTEX }); break;
+	case TEXCOORD_HALF: attributes.push_back({ 2, 2, GL_HALF_FLOAT, false, false, offset, BINDING_VERTEX }); break;
+	case TEXCOORD_UNORM16: attributes.push_back({ 2, 2, GL_UNSIGNED_SHORT, true, false, offset, BINDING_VERTEX }); break;
+	default: break;
+	}
+	offset += TexCoordBytes(texCoords);
+
+	if (tangents == TANGENT_FLOAT)
+	{
+		attributes.push_back({ 3, 3, GL_FLOAT, false, false, offset, BINDING_VERTEX });
+		attributes.push_back({ 4, 3, GL_FLOAT, false, false, static_cast<unsigned int>(offset + sizeof(glm::vec3)), BINDING_VERTEX });
+	}
+
+	AppendInstanceAttributes(attributes, false);
+	return attributes;
+}
+
+auto VertexLayout::PositionAttributes() const -> std::vector<VertexAttribute>
+{
+	auto attributes = std::vector<VertexAttribute>{ PositionAttribute(positions) };
+	AppendInstanceAttributes(attributes, true);
+	return attributes;
+}
+
+auto VertexLayout::Pack(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed) const -> void
+{
+	const auto stride = Stride();
+	packed.resize(vertices.size() * stride);
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		auto& vertex = vertices[i];
+		auto out = packed.data() + i * stride;
+
+		WritePosition(positions, vertex.Position, boundsMin, boundsMax, out);
+		out += PositionBytes(positions);
+
+		if (normals == NORMAL_FLOAT)
+		{
+			memcpy(out, &vertex.Normal, sizeof(glm::vec3));
+		}
+		else if (normals == NORMAL_INT_2_10_10_10)
+		{
+			const auto normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+			memcpy(out, &normal, sizeof(normal));
+		}
+		else if (normals == NORMAL_OCTAHEDRAL)
+		{
+			const auto octahedral = OctahedralEncode(vertex.Normal);
+			const glm::uint16 normal[2] = { glm::packSnorm1x16(octahedral.x), glm::packSnorm1x16(octahedral.y) };
+			memcpy(out, normal, sizeof(normal));
+		}
+		out += NormalBytes(normals);
+
+		if (texCoords == TEXCOORD_FLOAT)
+		{
+			memcpy(out, &vertex.TexCoords, sizeof(glm::vec2));
+		}
+		else if (texCoords == TEXCOORD_HALF)
+		{
+			const glm::uint16 texCoord[2] = { glm::packHalf1x16(vertex.TexCoords.x), glm::packHalf1x16(vertex.TexCoords.y) };
+			memcpy(out, texCoord, sizeof(texCoord));
+		}
+		else if (texCoords == TEXCOORD_UNORM16)
+		{
+			const glm::uint16 texCoord[2] = { glm::packUnorm1x16(vertex.TexCoords.x), glm::packUnorm1x16(vertex.TexCoords.y) };
+			memcpy(out, texCoord, sizeof(texCoord));
+		}
+		out += TexCoordBytes(texCoords);
+
+		if (tangents == TANGENT_FLOAT)
+		{
+			memcpy(out, &vertex.Tangent, sizeof(glm::vec3));
+			memcpy(out + sizeof(glm::vec3), &vertex.Bitangent, sizeof(glm::vec3));
+		}
+	}
+}
+
+auto VertexLayout::PackPositions(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed) const -> void
+{
+	const auto stride = PositionStride();
+	packed.resize(vertices.size() * stride);
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		WritePosition(positions, vertices[i].Position, boundsMin, boundsMax, packed.data() + i * stride);
+	}
+}
+
+auto VertexLayout::PositionTransform(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const -> glm::mat4
+{
+	if (positions != POSITION_UNORM16) return glm::mat4(1.0f);
+	return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
+}
+
+auto VertexLayout::Key() const -> unsigned int
+{
+	return static_cast<unsigned int>(positions) | static_cast<unsigned int>(normals) << 4
+		| static_cast<unsigned int>(texCoords) << 8 | static_cast<unsigned int>(tangents) << 12;
+}
+
+auto VertexLayout::operator==(const VertexLayout& other) const -> bool
+{
+	return Key() == other.Key();
+}
+
+auto VertexLayout::Standard() -> VertexLayout
+{
+	return VertexLayout{ POSITION_FLOAT, NORMAL_FLOAT, TEXCOORD_FLOAT, TANGENT_NONE };
+}
+
+auto VertexLayout::Compact() -> VertexLayout
+{
+	return VertexLayout{ POSITION_UNORM16, NORMAL_OCTAHEDRAL, TEXCOORD_HALF, TANGENT_NONE };
+}
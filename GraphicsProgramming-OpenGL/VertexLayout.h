@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include "Vertex.h"
+#include "VertexFormat.h"
+
+enum Position_Encoding
+{
+	POSITION_FLOAT,
+	// Three unorm16 relative to the mesh bounds (8 bytes with padding), decoded by
+	// Mesh::PositionTransform being folded into the model matrix
+	POSITION_UNORM16
+};
+
+enum Normal_Encoding
+{
+	NORMAL_NONE,
+	NORMAL_FLOAT,
+	// Signed 10_10_10_2, converted by the attribute fetch
+	NORMAL_INT_2_10_10_10,
+	// Two snorm16 on the octahedron, decoded in the shader when "octahedralNormals" is set
+	NORMAL_OCTAHEDRAL
+};
+
+enum TexCoord_Encoding
+{
+	TEXCOORD_NONE,
+	TEXCOORD_FLOAT,
+	TEXCOORD_HALF,
+	// Only for coordinates inside [0, 1], anything else is clamped
+	TEXCOORD_UNORM16
+};
+
+enum Tangent_Encoding
+{
+	TANGENT_NONE,
+	// Tangent and bitangent as attributes 3 and 4
+	TANGENT_FLOAT
+};
+
+// How the attributes of a Vertex are stored in a vertex buffer. Omitted attributes take no
+// space, the shader reads their default value. Each layout gets its own MeshPool, see
+// MeshPool::Shared.
+struct VertexLayout
+{
+	Position_Encoding positions;
+	Normal_Encoding normals;
+	TexCoord_Encoding texCoords;
+	Tangent_Encoding tangents;
+
+	// Bytes per vertex in the full stream and in the position stream
+	auto Stride() const -> unsigned int;
+	auto PositionStride() const -> unsigned int;
+
+	// Attributes 0-4 as present plus the instance attributes 5-10, and attribute 0 plus the
+	// instance transform for the position stream
+	auto Attributes() const -> std::vector<VertexAttribute>;
+	auto PositionAttributes() const -> std::vector<VertexAttribute>;
+
+	// Encode vertices into Stride / PositionStride bytes each, quantised positions span the
+	// given bounds
+	auto Pack(const std::vector<Vertex> & vertices, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, std::vector<unsigned char> & packed) const -> void;
+	auto PackPositions(const std::vector<Vertex> & vertices, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, std::vector<unsigned char> & packed) const -> void;
+
+	// Maps stored positions to object space, identity unless they are quantised
+	auto PositionTransform(const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const -> glm::mat4;
+
+	// Orders layouts for the pool table
+	auto Key() const -> unsigned int;
+	auto operator==(const VertexLayout & other) const -> bool;
+
+	// Float positions, normals and texture coordinates, 32 bytes
+	static auto Standard() -> VertexLayout;
+	// Quantised positions, octahedral normals and half float texture coordinates, 16 bytes
+	static auto Compact() -> VertexLayout;
+};
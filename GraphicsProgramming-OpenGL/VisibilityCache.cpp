@@ -0,0 +1,76 @@
+#include "VisibilityCache.h"
+
+auto VisibilityCache::Update(Scene& scene, const Camera& camera, FrustumG& frustum, const float fov, const float screenHeight, WorkerPool* workers) -> const std::vector<GameObject*>&
+{
+	const auto sceneCounter = scene.ChangeCounter();
+
+	const auto cameraUnchanged = camera.Position == position_ && camera.Front == front_ && camera.Up == up_
+		&& fov == fov_ && screenHeight == screenHeight_;
+
+	reused_ = valid_ && cameraUnchanged && sceneCounter == sceneCounter_ && &scene == scene_;
+	if (reused_)
+	{
+		++skippedFrames;
+		return visible_;
+	}
+
+	// Plane coherency is only meaningful while the object list stays the same
+	if (!valid_ || &scene != scene_ || rejectingPlane_.size() != scene.Objects().size())
+	{
+		rejectingPlane_.assign(scene.Objects().size(), -1);
+	}
+
+	// Each object is only touched by the chunk that holds it
+	const auto objectCount = static_cast<unsigned int>(scene.Objects().size());
+	visibleFlags_.assign(objectCount, 0);
+	const auto cull = [&](const unsigned int begin, const unsigned int end, unsigned int)
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			auto object = scene.Objects()[i];
+
+			glm::vec3 min, max;
+			object->GetWorldBounds(min, max);
+			if (frustum.boxInFrustum(min, max, rejectingPlane_[i]) == FrustumG::OUTSIDE) continue;
+
+			visibleFlags_[i] = object->UpdateLod(camera, fov, screenHeight) ? 1 : 0;
+		}
+	};
+
+	if (workers != nullptr)
+	{
+		workers->ParallelFor(objectCount, WORKER_CHUNK_SIZE, cull);
+	}
+	else
+	{
+		cull(0, objectCount, 0);
+	}
+
+	visible_.clear();
+	for (unsigned int i = 0; i < objectCount; ++i)
+	{
+		if (visibleFlags_[i]) visible_.push_back(scene.Objects()[i]);
+	}
+
+	position_ = camera.Position;
+	front_ = camera.Front;
+	up_ = camera.Up;
+	fov_ = fov;
+	screenHeight_ = screenHeight;
+	sceneCounter_ = sceneCounter;
+	scene_ = &scene;
+	valid_ = true;
+	++culledFrames;
+
+	return visible_;
+}
+
+auto VisibilityCache::Reused() const -> bool
+{
+	return reused_;
+}
+
+auto VisibilityCache::Invalidate() -> void
+{
+	valid_ = false;
+}
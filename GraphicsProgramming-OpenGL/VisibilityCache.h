@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "Scene.h"
+#include "Camera.h"
+#include "FrustumG.h"
+#include "WorkerPool.h"
+
+// Remembers the visible set of a scene between frames. While neither the camera nor the
+// scene changes the culling stage is skipped entirely, otherwise objects are re-culled
+// starting with the frustum plane that rejected them last time. Given a WorkerPool the
+// objects are culled in parallel chunks, the visible list keeps scene order either way.
+class VisibilityCache
+{
+public:
+	// Cull the scene and select levels of detail, returns the visible objects
+	auto Update(Scene & scene, const Camera & camera, FrustumG & frustum, float fov, float screenHeight, WorkerPool * workers = nullptr) -> const std::vector<GameObject *> &;
+
+	// True when the last Update reused the previous frame's result
+	auto Reused() const -> bool;
+	auto Invalidate() -> void;
+
+	// Frames culled / skipped since startup
+	unsigned long long culledFrames = 0;
+	unsigned long long skippedFrames = 0;
+
+private:
+	bool valid_ = false;
+	bool reused_ = false;
+
+	glm::vec3 position_;
+	glm::vec3 front_;
+	glm::vec3 up_;
+	float fov_ = 0.0f;
+	float screenHeight_ = 0.0f;
+	unsigned long long sceneCounter_ = 0;
+	const Scene * scene_ = nullptr;
+
+	std::vector<GameObject *> visible_;
+
+	// Plane that rejected each object last time, -1 when it wasn't rejected
+	std::vector<int> rejectingPlane_;
+
+	// Per-object result of the last cull, written by the workers before compaction
+	std::vector<char> visibleFlags_;
+};
@@ -0,0 +1,96 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threads) :
+	nextChunk_(0)
+{
+	if (threads == 0)
+	{
+		const auto hardware = std::thread::hardware_concurrency();
+		threads = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	for (unsigned int worker = 0; worker < threads; ++worker)
+	{
+		threads_.emplace_back(&WorkerPool::Run, this, worker);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+auto WorkerPool::ThreadCount() const -> unsigned int
+{
+	return static_cast<unsigned int>(threads_.size()) + 1;
+}
+
+auto WorkerPool::ParallelFor(const unsigned int count, const unsigned int chunkSize, const WorkerTask& task) -> void
+{
+	if (count == 0) return;
+
+	// Not worth waking anyone for a single chunk
+	const auto caller = ThreadCount() - 1;
+	if (threads_.empty() || count <= chunkSize)
+	{
+		task(0, count, caller);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		task_ = &task;
+		count_ = count;
+		chunkSize_ = std::max(chunkSize, 1u);
+		nextChunk_.store(0);
+		busy_ = static_cast<unsigned int>(threads_.size());
+		++job_;
+	}
+	wake_.notify_all();
+
+	RunChunks(caller);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return busy_ == 0; });
+	task_ = nullptr;
+}
+
+auto WorkerPool::Run(const unsigned int worker) -> void
+{
+	auto seenJob = 0ull;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this, seenJob] { return stop_ || job_ != seenJob; });
+			if (stop_) return;
+			seenJob = job_;
+		}
+
+		RunChunks(worker);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--busy_ == 0) done_.notify_one();
+	}
+}
+
+auto WorkerPool::RunChunks(const unsigned int worker) -> void
+{
+	for (;;)
+	{
+		const auto begin = nextChunk_.fetch_add(1) * chunkSize_;
+		if (begin >= count_) return;
+
+		(*task_)(begin, std::min(begin + chunkSize_, count_), worker);
+	}
+}
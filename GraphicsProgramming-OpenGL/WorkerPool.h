@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Objects handed to a worker at a time, small enough to balance, large enough that taking
+// a chunk costs nothing next to processing it
+const unsigned int WORKER_CHUNK_SIZE = 16;
+
+// (begin, end, worker) of one chunk
+typedef std::function<void(unsigned int, unsigned int, unsigned int)> WorkerTask;
+
+// Persistent threads for per-frame CPU work that never touches GL. ParallelFor splits a
+// range into chunks that the workers and the calling thread take in turn, and returns once
+// every chunk is done. Worker indices are stable and below ThreadCount, so callers can keep
+// per-worker scratch, e.g. a RenderQueue each.
+class WorkerPool
+{
+public:
+	// 0 threads picks one per hardware thread besides the caller's
+	explicit WorkerPool(unsigned int threads = 0);
+	~WorkerPool();
+	WorkerPool(const WorkerPool &) = delete;
+	auto operator=(const WorkerPool &) -> WorkerPool & = delete;
+
+	// Workers plus the calling thread, which runs as the last index
+	auto ThreadCount() const -> unsigned int;
+
+	auto ParallelFor(unsigned int count, unsigned int chunkSize, const WorkerTask & task) -> void;
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+
+	// The current job, published under mutex_
+	const WorkerTask * task_ = nullptr;
+	unsigned int count_ = 0;
+	unsigned int chunkSize_ = 1;
+	unsigned long long job_ = 0;
+	unsigned int busy_ = 0;
+	bool stop_ = false;
+
+	std::atomic<unsigned int> nextChunk_;
+
+	auto Run(unsigned int worker) -> void;
+	auto RunChunks(unsigned int worker) -> void;
+};
@@ -0,0 +1,24 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 5) in mat4 aInstanceModel;
+
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
+
+uniform mat4 model;
+uniform bool instanced;
+
+// Same expression as the lighting shaders, whose fragments are depth tested with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	mat4 objectModel = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * objectModel * vec4(aPos, 1.0);
+}
@@ -1,9 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
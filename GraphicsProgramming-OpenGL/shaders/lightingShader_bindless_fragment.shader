@@ -0,0 +1,128 @@
+#version 430 core
+#extension GL_ARB_bindless_texture : require
+
+// Camera position for the specular angle / intensity, and time, see UniformBuffer.h
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
+
+// --- Light block -----------------------------------
+layout (std140) uniform LightData
+{
+	vec3 position;
+
+	// Light components
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+} light;
+
+// --- Material table ----------------------------------
+// Resident texture handles and surface parameters of every material, indexed by
+// material id, see MaterialTableEntry in Material.h
+struct MaterialEntry
+{
+	uvec2 diffuse;
+	uvec2 specular;
+	uvec2 emission;
+	float shininess;
+	float emissionIntensity;
+};
+
+layout (std430, binding = 3) readonly buffer MaterialTable
+{
+	MaterialEntry materials[];
+};
+
+uniform sampler2D shadowMap;
+
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+in vec4 FragPosLightSpace;
+in vec4 InstanceParams;	// rgb tint, a emission scale
+flat in int MaterialIndex;
+
+vec4 SampleMaterial(uvec2 handle, vec2 coords)
+{
+	if (handle == uvec2(0)) return vec4(0.0, 0.0, 0.0, 1.0);
+	return texture(sampler2D(handle), coords);
+}
+
+float ShadowCalculation(vec4 fragPosLightSpace)
+{
+	// perform perspective divide
+	vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+	// transform to [0,1] range
+	projCoords = projCoords * 0.5 + 0.5;
+	// get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
+	float closestDepth = texture(shadowMap, projCoords.xy).r;
+	// get depth of current fragment from light's perspective
+	float currentDepth = projCoords.z;
+
+	float bias = 0.005;
+
+	// check whether current frag pos is in shadow
+	float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+
+	return shadow;
+}
+
+void main()
+{
+	MaterialEntry material = materials[MaterialIndex];
+
+	// Calculate the normal from the normal map
+	//vec3 texnormal = texture(material.texture_normal1, TexCoords).rgb;
+	// Transform the normal vector to range [-1, 1]
+	//texnormal = normalize(texnormal * 2.0 - 1.0);
+
+	// --- Ambient Lighting -------------------------------------------------------
+	vec3 diffuseColor = SampleMaterial(material.diffuse, TexCoords).rgb;
+	vec3 ambient = light.ambient * diffuseColor;
+
+	// --- Diffuse Lighting -------------------------------------------------------
+	vec3 normal = normalize(Normal);
+
+	vec3 lightDirection = normalize(light.position - FragPos);
+
+	float diff = max(dot(normal, lightDirection), 0.0);
+	vec3 diffuse = light.diffuse * diff * diffuseColor;
+
+//	diff = max(dot(texnormal, lightDirection), 0.0);
+//	vec3 diffuseNormal = light.diffuse * diff * texture(material.texture_diffuse1, TexCoords).rgb;
+
+	// --- Specular lighting ------------------------------------------------------
+	// Calculate the view direction and corresponding reflect vector (along normal axis)
+	vec3 viewDirection = normalize(viewPosition - FragPos);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+
+//	vec3 reflectDirectionTexNormal = reflect(-lightDirection, texnormal);
+
+	// Calculate the specular component
+	float specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), material.shininess);
+	vec3 specular = light.specular * specularPower * SampleMaterial(material.specular, TexCoords).rgb;
+	
+//	specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), shininess);
+//	vec3 specularNormal = light.specular * specularPower * vec3(texture(material.texture_specular1, TexCoords));
+//
+//	diffuse = (diffuse + diffuseNormal) / 2;
+//	specular = (specular + specularNormal) / 2;
+
+	// Add an emission map for giggles
+	vec3 emission = material.emissionIntensity * SampleMaterial(material.emission, TexCoords + vec2(0.0, time)).rgb;
+	
+	// result += (emissionIntensity * vec3(texture(material.emission, TexCoords + vec2(0.0, time))));
+
+	// Calculate shadow
+	float shadow = ShadowCalculation(FragPosLightSpace);
+
+    FragColor = vec4(InstanceParams.rgb * (ambient + ((1.0 - shadow) * (diffuse + specular))) + InstanceParams.a * emission, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+// Per-instance attributes, only used when instanced is set
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec4 aInstanceParams;
+layout (location = 10) in int aMaterialIndex;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec4 FragPosLightSpace;
+out vec4 InstanceParams;
+flat out int MaterialIndex;
+
+// Shared per-frame data, see UniformBuffer.h
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
+
+uniform mat4 model;
+uniform bool instanced;
+// Normals stored as two snorm16 on the octahedron, see VertexLayout.h
+uniform bool octahedralNormals;
+
+// Must match the depth pre-pass exactly, see depthPrepass_vertex.shader
+invariant gl_Position;
+
+// Row of the material table, see Material.h
+uniform int materialIndex;
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0)
+	{
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(normal);
+}
+
+void main()
+{
+	mat4 objectModel = instanced ? aInstanceModel : model;
+	InstanceParams = instanced ? aInstanceParams : vec4(1.0);
+	MaterialIndex = instanced ? aMaterialIndex : materialIndex;
+
+	FragPos = vec3(objectModel * vec4(aPos, 1.0));
+	FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
+	Normal = octahedralNormals ? OctahedralDecode(aNormal.xy) : aNormal;
+	TexCoords = aTexCoords;
+
+	gl_Position = projection * view * objectModel * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -1,35 +1,52 @@
 ﻿#version 330 core
 
-// Take in the camera position to calculated specular angle / intensity
-uniform vec3 viewPosition;
+// Camera position for the specular angle / intensity, and time, see UniformBuffer.h
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
 
-// --- Define a struct for the Light -----------------
-struct Light {
+// --- Light block -----------------------------------
+layout (std140) uniform LightData
+{
 	vec3 position;
 
 	// Light components
 	vec3 ambient;
 	vec3 diffuse;
 	vec3 specular;
-};
+} light;
 
-uniform Light light;
-
-// --- Define a struct for the Material --------------
+// --- Material samplers and block -------------------
 struct Material {
 	sampler2D texture_diffuse1;
 	sampler2D texture_specular1;
 	sampler2D texture_normal1;
 	sampler2D emission;
-	float shininess;
+
+	// Texture arrays shared between materials, see TextureArrays.h
+	sampler2DArray diffuseArray;
+	sampler2DArray specularArray;
+	sampler2DArray emissionArray;
 };
 
 uniform sampler2D shadowMap;
 
 uniform Material material;
 
-uniform float emissionIntensity;
-uniform float time;
+layout (std140) uniform MaterialData
+{
+	float shininess;
+	float emissionIntensity;
+
+	// Sample the arrays at the diffuse, specular and emission layers, -1 where there is no texture
+	bool textureArrays;
+	ivec4 layers;
+};
 
 out vec4 FragColor;
 
@@ -37,6 +54,14 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 in vec4 FragPosLightSpace;
+in vec4 InstanceParams;	// rgb tint, a emission scale
+
+vec4 SampleMaterial(sampler2D map, sampler2DArray array, int layer, vec2 coords)
+{
+	if (!textureArrays) return texture(map, coords);
+	if (layer < 0) return vec4(0.0, 0.0, 0.0, 1.0);
+	return texture(array, vec3(coords, layer));
+}
 
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
@@ -65,7 +90,8 @@ void main()
 	//texnormal = normalize(texnormal * 2.0 - 1.0);
 
 	// --- Ambient Lighting -------------------------------------------------------
-	vec3 ambient = light.ambient * texture(material.texture_diffuse1, TexCoords).rgb;
+	vec3 diffuseColor = SampleMaterial(material.texture_diffuse1, material.diffuseArray, layers.x, TexCoords).rgb;
+	vec3 ambient = light.ambient * diffuseColor;
 
 	// --- Diffuse Lighting -------------------------------------------------------
 	vec3 normal = normalize(Normal);
@@ -73,7 +99,7 @@ void main()
 	vec3 lightDirection = normalize(light.position - FragPos);
 
 	float diff = max(dot(normal, lightDirection), 0.0);
-	vec3 diffuse = light.diffuse * diff * texture(material.texture_diffuse1, TexCoords).rgb;
+	vec3 diffuse = light.diffuse * diff * diffuseColor;
 
 //	diff = max(dot(texnormal, lightDirection), 0.0);
 //	vec3 diffuseNormal = light.diffuse * diff * texture(material.texture_diffuse1, TexCoords).rgb;
@@ -86,22 +112,22 @@ void main()
 //	vec3 reflectDirectionTexNormal = reflect(-lightDirection, texnormal);
 
 	// Calculate the specular component
-	float specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), material.shininess);
-	vec3 specular = light.specular * specularPower * vec3(texture(material.texture_specular1, TexCoords));
+	float specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), shininess);
+	vec3 specular = light.specular * specularPower * SampleMaterial(material.texture_specular1, material.specularArray, layers.y, TexCoords).rgb;
 	
-//	specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), material.shininess);
+//	specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), shininess);
 //	vec3 specularNormal = light.specular * specularPower * vec3(texture(material.texture_specular1, TexCoords));
 //
 //	diffuse = (diffuse + diffuseNormal) / 2;
 //	specular = (specular + specularNormal) / 2;
 
 	// Add an emission map for giggles
-	vec3 emission = emissionIntensity * vec3(texture(material.emission, TexCoords + vec2(0.0, time)));
+	vec3 emission = emissionIntensity * SampleMaterial(material.emission, material.emissionArray, layers.z, TexCoords + vec2(0.0, time)).rgb;
 	
 	// result += (emissionIntensity * vec3(texture(material.emission, TexCoords + vec2(0.0, time))));
 
 	// Calculate shadow
 	float shadow = ShadowCalculation(FragPosLightSpace);
 
-    FragColor = vec4(ambient + ((1.0 - shadow) * (diffuse + specular)) + emission, 1.0);
+    FragColor = vec4(InstanceParams.rgb * (ambient + ((1.0 - shadow) * (diffuse + specular))) + InstanceParams.a * emission, 1.0);
 }
\ No newline at end of file
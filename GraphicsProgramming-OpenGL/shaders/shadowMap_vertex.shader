@@ -1,10 +1,21 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
+layout(location = 5) in mat4 aInstanceModel;
+
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 lightSpaceMatrix;
+	vec3 viewPosition;
+	float time;
+};
 
-uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
+uniform bool instanced;
 
 void main()
 {
-	gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+	mat4 objectModel = instanced ? aInstanceModel : model;
+	gl_Position = lightSpaceMatrix * objectModel * vec4(aPos, 1.0);
 }
\ No newline at end of file